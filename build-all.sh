@@ -24,4 +24,13 @@ then
     echo "Error: $ERRORLEVEL" && exit
 fi
 
+pushd tools/logdecode
+source build.sh
+popd
+ERRORLEVEL=$?
+if [ $ERRORLEVEL -ne 0 ]
+then
+    echo "Error: $ERRORLEVEL" && exit
+fi
+
 echo "All assemblies built successfully."
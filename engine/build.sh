@@ -11,7 +11,7 @@ assembly="engine"
 cflags="-g -shared -fdeclspec -fPIC"
 
 includes="-Isrc -I$VULKAN_SDK/include"
-ldflags="-lvulkan -lxcb -lX11 -lX11-xcb -lxkbcommon -L$VULKAN_SDK/lib -L/usr/X11/lib"
+ldflags="-lvulkan -lxcb -lxcb-xinput -lX11 -lX11-xcb -lxkbcommon -lpthread -ldl -L$VULKAN_SDK/lib -L/usr/X11/lib"
 defines="-D_DEBUG -DPEXPORT"
 
 echo "Building $assembly..."
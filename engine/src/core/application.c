@@ -5,6 +5,13 @@
 #include "core/pmemory.h"
 #include "core/event.h"
 #include "core/input.h"
+#include "core/input_recorder.h"
+#include "core/input_action.h"
+#include "core/game_module.h"
+#include "core/profiler.h"
+#include "core/frame_pacer.h"
+#include "core/frame_stats.h"
+#include "core/job_system.h"
 #include "logger.h"
 #include "clock.h"
 
@@ -12,6 +19,13 @@
 
 #include <string.h>
 
+// The profile capture key writes this many frames to a trace file
+#define PROFILE_CAPTURE_FRAMES 300
+#define PROFILE_CAPTURE_PATH "profile.json"
+
+// Fixed steps run in one frame when the config does not say
+#define DEFAULT_MAX_SUBSTEPS 5
+
 typedef struct application_state {
     game* game_inst;
     b8 is_running;
@@ -20,7 +34,14 @@ typedef struct application_state {
     i16 width;
     i16 height;
     clock clock;
-    f64 last_time;
+    u64 last_ticks;
+
+    // Fixed timestep, kept in nanoseconds so a replay steps the same way whatever
+    // the tick frequency of the run. step_ns is 0 when updates use the frame delta
+    u64 step_ns;
+    f32 step_seconds;
+    u32 max_substeps;
+    u64 accumulator_ns;
 } application_state;
 
 static b8 initialized = FALSE;
@@ -41,12 +62,41 @@ application_create(game* game_inst) {
 
     // Initialize subsystems
     // initialize_memory();
-    initialize_logging();
+    initialize_logging(&game_inst->app_config.logging);
+    if (game_inst->app_config.game_module_path && !game_module_load(game_inst, game_inst->app_config.game_module_path)) {
+        P_FATAL("Game module could not be loaded. Application cannot continue");
+        return FALSE;
+    }
+    profiler_initialize();
+    if (game_inst->app_config.hardware_counters) {
+        profiler_enable_counters(TRUE);
+    }
+    // The render thread gets a physical core of its own, away from the workers
+    if (game_inst->app_config.renderer.threaded && game_inst->app_config.jobs.reserved_cores == 0) {
+        game_inst->app_config.jobs.reserved_cores = 1;
+    }
+    if (!job_system_initialize(&game_inst->app_config.jobs)) {
+        P_FATAL("Job system could not initialize. Application cannot continue");
+        return FALSE;
+    }
+    frame_pacer_initialize(&game_inst->app_config.pacing);
+    frame_stats_initialize();
     input_initialize();
+    input_action_initialize();
+    if (!input_recorder_initialize(&game_inst->app_config.input_recording)) {
+        P_FATAL("Input recorder could not initialize. Application cannot continue");
+        return FALSE;
+    }
 
     app_state.is_running = TRUE;
     app_state.is_suspended = FALSE;
 
+    if (game_inst->app_config.fixed_timestep > 0) {
+        app_state.step_seconds = (f32)game_inst->app_config.fixed_timestep;
+        app_state.step_ns = (u64)(game_inst->app_config.fixed_timestep * 1000000000.0);
+        app_state.max_substeps = game_inst->app_config.max_substeps ? game_inst->app_config.max_substeps : DEFAULT_MAX_SUBSTEPS;
+    }
+
     // Initialize event system
     if (!event_initialize()) {
         P_ERROR("Event system could not initialize. Application cannot continue");
@@ -65,14 +115,15 @@ application_create(game* game_inst) {
             game_inst->app_config.start_pos_x, 
             game_inst->app_config.start_pos_y, 
             game_inst->app_config.start_width, 
-            game_inst->app_config.start_height
+            game_inst->app_config.start_height,
+            game_inst->app_config.headless
         )) {
         return FALSE;
     }
 
     // P_TRACE("GOT HERE");
     // Renderer startup
-    if (!renderer_initialize(game_inst->app_config.name, &app_state.platform)) {
+    if (!renderer_initialize(game_inst->app_config.name, &app_state.platform, &game_inst->app_config.renderer)) {
         P_FATAL("Unable to initialize renderer. Aborting application");
         return FALSE;
     }
@@ -90,73 +141,169 @@ application_create(game* game_inst) {
     return TRUE;
 }
 
+/*
+  Run the game's update for a frame that took frame_ns
+  With a fixed timestep the frame time is banked, and the game is updated
+  once per whole step banked, up to max_substeps. What is left over becomes
+  the render alpha
+*/
+static b8
+application_update(u64 frame_ns, f32 delta, f32* out_alpha) {
+    if (app_state.step_ns == 0) {
+        *out_alpha = 1.0f;
+        return app_state.game_inst->update(app_state.game_inst, delta);
+    }
+
+    app_state.accumulator_ns += frame_ns;
+    u32 steps = 0;
+    while (app_state.accumulator_ns >= app_state.step_ns && steps < app_state.max_substeps) {
+        if (!app_state.game_inst->update(app_state.game_inst, app_state.step_seconds)) {
+            return FALSE;
+        }
+        app_state.accumulator_ns -= app_state.step_ns;
+        steps++;
+    }
+
+    // Still behind after the most steps a frame may take. Catching up would make the
+    // next frame slower still, so drop the backlog and let the simulation fall behind
+    if (app_state.accumulator_ns >= app_state.step_ns) {
+        u64 dropped = app_state.accumulator_ns - app_state.accumulator_ns % app_state.step_ns;
+        P_WARN("Game update fell behind. Skipped %.2fms of simulation", dropped / 1000000.0);
+        app_state.accumulator_ns -= dropped;
+    }
+
+    *out_alpha = (f32)((f64)app_state.accumulator_ns / (f64)app_state.step_ns);
+    return TRUE;
+}
+
 b8
 application_run() {
     clock_start(&app_state.clock);
     clock_update(&app_state.clock);
-    app_state.last_time = app_state.clock.elapsed;
-    f64 running_time = 0;
-    u8 frame_count = 0;
-    f64 target_frame_seconds = 1.0F / 60; // 60fps
+    app_state.last_ticks = app_state.clock.elapsed_ticks;
 
     char* mem_usage = get_memory_usage_str();
-    P_INFO(mem_usage);
+    P_INFO("%s", mem_usage);
     pfree(mem_usage, strlen(mem_usage), MEMORY_TAG_STRING);
 
     while (app_state.is_running) {
-        if (!platform_pump_messages(&app_state.platform)) {
+        // Swap in a new build of the game between frames
+        if (!game_module_update(app_state.game_inst)) {
+            P_FATAL("New build of the game module could not bind. Shutting down");
             app_state.is_running = FALSE;
+            break;
         }
 
-        if (!app_state.is_suspended) {
-            clock_update(&app_state.clock);
-            f64 current_time = app_state.clock.elapsed;
-            f64 delta = (current_time - app_state.last_time);
-            f64 frame_start_time = platform_get_absolute_time();
-
-            if (!app_state.game_inst->update(app_state.game_inst, (f32)delta)) {
-                P_FATAL("Game update failed. Shutting down");
+        u64 phase_start = platform_get_ticks();
+        {
+            P_PROFILE_SCOPE("pump messages");
+            if (!platform_pump_messages(&app_state.platform)) {
                 app_state.is_running = FALSE;
-                break;
             }
+        }
+        u64 pump_ticks = platform_get_ticks() - phase_start;
 
-            // Call the game's render routine
-            if (!app_state.game_inst->render(app_state.game_inst, (f32)delta)) {
-                P_FATAL("Game render failed. Shutting down");
-                app_state.is_running = FALSE;
-                break;
+        if (!app_state.is_suspended) {
+            clock_update(&app_state.clock);
+            u64 current_ticks = app_state.clock.elapsed_ticks;
+            u64 frame_ticks = current_ticks - app_state.last_ticks;
+
+            // A replay hands the game the recorded frame lengths, so it takes the same steps every run.
+            // They are used in nanoseconds as recorded: the tick frequency is measured again
+            // each run, and converting to ticks would round differently. Frame stats keep measuring real time
+            u64 game_ns;
+            if (input_recorder_get_mode() == INPUT_RECORDER_MODE_REPLAY) {
+                if (!input_recorder_next_frame(&game_ns)) {
+                    P_INFO("Input replay finished. Shutting down");
+                    app_state.is_running = FALSE;
+                    break;
+                }
+            } else {
+                game_ns = clock_ticks_to_ns(frame_ticks);
             }
-
-            /// TODO: refactor packet creation
-            render_packet packet;
-            packet.delta_time = delta;
-            renderer_draw_frame(&packet);
-
-            f64 frame_end_time = platform_get_absolute_time();
-            f64 frame_elapsed_time = frame_end_time - frame_start_time;
-            running_time += frame_elapsed_time;
-            f64 remaining_seconds = target_frame_seconds - frame_elapsed_time;
-
-            if (remaining_seconds > 0) {
-                u64 remaining_ms = (remaining_seconds * 1000);
-
-                // If there is time left
-                // give it back to the OS
-                b8 limit_frames = FALSE;
-                if (remaining_ms > 0 && limit_frames) {
-                    platform_sleep(remaining_ms - 1);
+            f64 delta = (f64)game_ns / 1000000000.0;
+            f32 alpha = 1.0f;
+
+            // Every action is evaluated once, against all of the frame's input
+            input_action_update();
+
+            frame_stats_record(FRAME_STATS_PHASE_FRAME, frame_ticks);
+            frame_stats_record(FRAME_STATS_PHASE_PUMP_MESSAGES, pump_ticks);
+            phase_start = platform_get_ticks();
+
+            {
+                P_PROFILE_SCOPE("game update");
+                if (!application_update(game_ns, (f32)delta, &alpha)) {
+                    P_FATAL("Game update failed. Shutting down");
+                    app_state.is_running = FALSE;
+                    break;
                 }
+            }
+            phase_start = frame_stats_phase_end(FRAME_STATS_PHASE_GAME_UPDATE, phase_start);
 
-                frame_count++;
+            // Call the game's render routine
+            {
+                P_PROFILE_SCOPE("game render");
+                if (!app_state.game_inst->render(app_state.game_inst, (f32)delta, alpha)) {
+                    P_FATAL("Game render failed. Shutting down");
+                    app_state.is_running = FALSE;
+                    break;
+                }
             }
+            phase_start = frame_stats_phase_end(FRAME_STATS_PHASE_GAME_RENDER, phase_start);
+
+            // With a render thread this only queues the packet, and waits while the
+            // thread is still behind on earlier frames
+            {
+                P_PROFILE_SCOPE("draw frame");
+                /// TODO: refactor packet creation
+                render_packet packet;
+                packet.delta_time = delta;
+                renderer_draw_frame(&packet);
+            }
+            phase_start = frame_stats_phase_end(FRAME_STATS_PHASE_DRAW_FRAME, phase_start);
 
             /// NOTE: input update/state copying should always be handled
             ///       after any input should be recorded. IE before this line
             ///       As a safety, input is the last thing to be updated before the frame ends
-            input_update(delta);
+            {
+                P_PROFILE_SCOPE("input update");
+                input_recorder_end_frame(game_ns);
+                input_update(delta);
+            }
+            frame_stats_phase_end(FRAME_STATS_PHASE_INPUT_UPDATE, phase_start);
+
+            event_profiling_update();
+            profiler_frame_end();
+
+            // Hold the frame until its deadline when a target frame rate is set
+            {
+                P_PROFILE_SCOPE("frame pacing");
+                phase_start = platform_get_ticks();
+                frame_pacer_wait();
+                frame_stats_phase_end(FRAME_STATS_PHASE_FRAME_PACING, phase_start);
+            }
+            frame_stats_end_frame();
+
+            u64 frame_limit = app_state.game_inst->app_config.frame_limit;
+            if (frame_limit > 0 && frame_stats_frame_count() >= frame_limit) {
+                P_INFO("Reached the limit of %llu frames. Shutting down", frame_limit);
+                app_state.is_running = FALSE;
+            }
 
             // Update the last time
-            app_state.last_time = current_time;
+            app_state.last_ticks = current_ticks;
+        } else {
+            // Nothing to update or draw until the window comes back. Sleep until the platform has messages
+            {
+                P_PROFILE_SCOPE("suspended");
+                platform_wait_messages(&app_state.platform, PLATFORM_WAIT_INFINITE);
+            }
+
+            // Time spent suspended is not part of any frame
+            clock_update(&app_state.clock);
+            app_state.last_ticks = app_state.clock.elapsed_ticks;
+            frame_pacer_restart();
         }
     }
     app_state.is_running = FALSE; // ensure that we begin shutdown process with correct information
@@ -167,10 +314,21 @@ application_run() {
     event_unregister(EVENT_CODE_RESIZED, 0, application_on_resize);
     
     event_shutdown();
+    input_recorder_shutdown();
+    input_action_shutdown();
     input_shutdown();
     renderer_shutdown();
     platform_shutdown(&app_state.platform);
+    job_system_shutdown();
+    // Last, so no frame still being drawn or job still running can call into the module
+    game_module_unload(app_state.game_inst);
+    if (frame_pacer_get_target() > 0) {
+        frame_pacer_dump();
+    }
     P_INFO("APPLICATION SHUTTING DOWN");
+    // The log writer records profile zones, so stop it before the profiler
+    shutdown_loggin();
+    profiler_shutdown();
 
     return TRUE;
 }
@@ -210,6 +368,19 @@ application_on_key(u16 code, void* sender, void* listener_inst, event_context co
 
             // Block anything else from processing this
             return TRUE;
+        }
+
+        // Debug hotkeys leave the key to other listeners and the action map
+        application_config* config = &app_state.game_inst->app_config;
+        if (config->profile_capture_key && key_code == config->profile_capture_key) {
+            // Capture a trace, or cut the one in progress short
+            if (profiler_capturing()) {
+                profiler_capture_stop();
+            } else {
+                profiler_capture_start(PROFILE_CAPTURE_PATH, PROFILE_CAPTURE_FRAMES);
+            }
+        } else if (config->frame_stats_key && key_code == config->frame_stats_key) {
+            frame_stats_dump();
         } else if (key_code == KEY_A) {
             // Example for checking A key
             P_DEBUG("Explicit - A key pressed");
@@ -1,6 +1,12 @@
 #pragma once
 
 #include "defines.h"
+#include "core/logger.h"
+#include "core/frame_pacer.h"
+#include "core/job_system.h"
+#include "core/input.h"
+#include "core/input_recorder.h"
+#include "renderer/renderer_types.inl"
 
 struct game;
 
@@ -10,6 +16,19 @@ typedef struct application_config {
     i16 start_width;  // Window starting width
     i16 start_height; // Window starting height
     char *name;       // Application name, if applicable
+    logger_config logging; // Log outputs. Zeroed for console only
+    frame_pacer_config pacing; // Frame rate cap. Zeroed for uncapped
+    f64 fixed_timestep; // Seconds per game update step. 0 runs one variable length update per frame
+    u32 max_substeps;   // Most fixed steps run in one frame before the backlog is dropped. 0 uses a default
+    b8 hardware_counters; // Count cycles, instructions and cache/branch misses per profile zone. Linux only
+    job_system_config jobs; // Worker threads. Zeroed for one per physical core, each pinned to its core
+    renderer_config renderer; // Render thread. Zeroed to draw on the main thread
+    b8 headless;      // Run without a window, drawing offscreen. Also forced by the PEGASUS_HEADLESS environment variable
+    u64 frame_limit;  // Quit after this many frames, for benchmark runs. 0 runs until closed
+    input_recorder_config input_recording; // Record input to a file, or replay it. Zeroed for neither
+    const char* game_module_path; // Shared library to take the game's functions from, reloaded when it changes. 0 when they are linked in
+    keys profile_capture_key; // Starts or stops a profiler trace capture. 0 for none
+    keys frame_stats_key;     // Logs the frame time statistics. 0 for none
 } application_config;
 
 P_API b8 application_create(struct game* game_inst);
@@ -3,18 +3,46 @@
 
 void
 clock_update(clock* clock) {
-  if (clock->start_time != 0) {
-    clock->elapsed = platform_get_absolute_time() - clock->start_time;
+  if (clock->start_ticks != 0) {
+    clock->elapsed_ticks = platform_get_ticks() - clock->start_ticks;
+    clock->elapsed = clock_ticks_to_seconds(clock->elapsed_ticks);
   }
 }
 
 void
 clock_start(clock* clock) {
-  clock->start_time = platform_get_absolute_time();
+  clock->start_ticks = platform_get_ticks();
+  clock->elapsed_ticks = 0;
   clock->elapsed = 0;
 }
 
 void
 clock_stop(clock* clock) {
-  clock->start_time = 0;
-}
\ No newline at end of file
+  clock->start_ticks = 0;
+}
+
+// Split into whole seconds and the remainder so the multiply cannot overflow
+static u64
+clock_scale(u64 value, u64 from_rate, u64 to_rate) {
+  return (value / from_rate) * to_rate + (value % from_rate) * to_rate / from_rate;
+}
+
+u64
+clock_ticks_to_ns(u64 ticks) {
+  return clock_scale(ticks, platform_get_tick_frequency(), 1000000000ULL);
+}
+
+u64
+clock_ticks_to_us(u64 ticks) {
+  return clock_scale(ticks, platform_get_tick_frequency(), 1000000ULL);
+}
+
+f64
+clock_ticks_to_seconds(u64 ticks) {
+  return (f64)ticks / (f64)platform_get_tick_frequency();
+}
+
+u64
+clock_ns_to_ticks(u64 ns) {
+  return clock_scale(ns, 1000000000ULL, platform_get_tick_frequency());
+}
@@ -2,18 +2,29 @@
 
 #include "defines.h"
 
+// Times are kept as platform ticks, see platform_get_ticks
 typedef struct clock {
-  f64 start_time;
+  u64 start_ticks;
+  u64 elapsed_ticks;
+  // elapsed_ticks in seconds, as of the last update
   f64 elapsed;
 } clock;
 
 // CLOCK INTERFACE
 
 // Has no effect on non-started clocks
-void clock_update(clock* clock);
+P_API void clock_update(clock* clock);
 
 // Starts the provided clock. Resets elapsed time
-void clock_start(clock* clock);
+P_API void clock_start(clock* clock);
 
 // Stops the input clock. Does not reset the elapsed time
-void clock_stop(clock* clock);
\ No newline at end of file
+P_API void clock_stop(clock* clock);
+
+// TICK CONVERSIONS
+// Integer conversions are exact for any span a u64 of nanoseconds can hold
+
+P_API u64 clock_ticks_to_ns(u64 ticks);
+P_API u64 clock_ticks_to_us(u64 ticks);
+P_API f64 clock_ticks_to_seconds(u64 ticks);
+P_API u64 clock_ns_to_ticks(u64 ns);
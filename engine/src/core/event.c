@@ -3,14 +3,24 @@
 #include "core/pmemory.h"
 #include "containers/darray.h"
 #include "core/logger.h"
+#include "platform/platform.h"
 
 typedef struct registered_event {
   void* listener;
   PFN_on_event callback;
+#if EVENT_PROFILING_ENABLED
+  u64 call_count;   // times the callback was invoked
+  f64 total_time;   // cumulative seconds spent inside the callback, including nested fires
+  f64 max_time;     // longest single invocation in seconds
+#endif
 } registered_event;
 
 typedef struct event_code_entry {
   registered_event* events;
+#if EVENT_PROFILING_ENABLED
+  u64 fire_count;    // times event_fire was called with this code
+  u64 handled_count; // times a listener consumed the event
+#endif
 } event_code_entry;
 
 // This should be more than enough
@@ -20,6 +30,11 @@ typedef struct event_code_entry {
 typedef struct event_system_state {
   // Lookup table for event codes
   event_code_entry registered[MAX_MESSAGE_CODES];
+
+  // Dispatch profiling
+  b8 profiling_enabled;
+  f64 report_interval;
+  f64 last_report_time;
 } event_system_state;
 
 /**
@@ -73,7 +88,7 @@ event_register(u16 code, void* listener, PFN_on_event on_event) {
   }
 
   // We no know duplicates were found and we can proceed with registration
-  registered_event event;
+  registered_event event = {};
   event.listener = listener;
   event.callback = on_event;
   darray_push(state.registered[code].events, event);
@@ -116,6 +131,40 @@ event_fire(u16 code, void* sender, event_context context) {
     return FALSE;
   }
 
+#if EVENT_PROFILING_ENABLED
+  if (state.profiling_enabled) {
+    state.registered[code].fire_count++;
+
+    u64 registered_count = darray_length(state.registered[code].events);
+    for (u64 i = 0; i < registered_count; ++i) {
+      // Listeners may unregister themselves from inside the callback,
+      // so re-index the array rather than holding a pointer across the call
+      registered_event ev = state.registered[code].events[i];
+      f64 start = platform_get_absolute_time();
+      b8 handled = ev.callback(code, sender, ev.listener, context);
+      f64 elapsed = platform_get_absolute_time() - start;
+
+      if (i < darray_length(state.registered[code].events)) {
+        registered_event* stats = &state.registered[code].events[i];
+        if (stats->callback == ev.callback && stats->listener == ev.listener) {
+          stats->call_count++;
+          stats->total_time += elapsed;
+          if (elapsed > stats->max_time) {
+            stats->max_time = elapsed;
+          }
+        }
+      }
+
+      if (handled) {
+        state.registered[code].handled_count++;
+        return TRUE;
+      }
+    }
+
+    return FALSE;
+  }
+#endif
+
   u64 registered_count = darray_length(state.registered[code].events);
   for (u64 i = 0; i < registered_count; ++i) {
     registered_event ev = state.registered[code].events[i];
@@ -127,4 +176,101 @@ event_fire(u16 code, void* sender, event_context context) {
 
   // Could not find matching sender
   return FALSE;
+}
+
+void
+event_profiling_set_enabled(b8 enabled) {
+  state.profiling_enabled = enabled;
+  state.last_report_time = platform_get_absolute_time();
+#if !EVENT_PROFILING_ENABLED
+  if (enabled) {
+    P_WARN("event_profiling_set_enabled: event profiling was compiled out (EVENT_PROFILING_ENABLED=0)");
+  }
+#endif
+}
+
+void
+event_profiling_set_report_interval(f64 seconds) {
+  state.report_interval = seconds;
+  state.last_report_time = platform_get_absolute_time();
+}
+
+void
+event_profiling_reset() {
+#if EVENT_PROFILING_ENABLED
+  for (u32 code = 0; code < MAX_MESSAGE_CODES; ++code) {
+    event_code_entry* entry = &state.registered[code];
+    entry->fire_count = 0;
+    entry->handled_count = 0;
+
+    if (entry->events != 0) {
+      u64 registered_count = darray_length(entry->events);
+      for (u64 i = 0; i < registered_count; ++i) {
+        entry->events[i].call_count = 0;
+        entry->events[i].total_time = 0;
+        entry->events[i].max_time = 0;
+      }
+    }
+  }
+#endif
+}
+
+void
+event_profiling_dump() {
+#if EVENT_PROFILING_ENABLED
+  P_INFO("Event dispatch profile:");
+  for (u32 code = 0; code < MAX_MESSAGE_CODES; ++code) {
+    event_code_entry* entry = &state.registered[code];
+    if (entry->fire_count == 0) {
+      continue;
+    }
+
+    // One line per code and listener, which can run past the rate limit of a call site
+    P_INFO_UNLIMITED(" code 0x%04x: fired %llu, handled %llu", code, entry->fire_count, entry->handled_count);
+    if (entry->events == 0 || darray_length(entry->events) == 0) {
+      continue;
+    }
+
+    // Report the listeners most expensive first. Sort pointers so the
+    // dispatch order of the registered array is left untouched
+    u64 registered_count = darray_length(entry->events);
+    registered_event** sorted = pallocate(sizeof(registered_event*) * registered_count, MEMORY_TAG_ARRAY);
+    for (u64 i = 0; i < registered_count; ++i) {
+      u64 j = i;
+      while (j > 0 && sorted[j - 1]->total_time < entry->events[i].total_time) {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = &entry->events[i];
+    }
+
+    for (u64 i = 0; i < registered_count; ++i) {
+      registered_event* ev = sorted[i];
+      f64 average = ev->call_count ? ev->total_time / ev->call_count : 0;
+      P_INFO_UNLIMITED("   callback %p listener %p: calls %llu, total %.3fms, avg %.3fus, max %.3fus",
+        (void*)ev->callback,
+        ev->listener,
+        ev->call_count,
+        ev->total_time * 1000.0,
+        average * 1000000.0,
+        ev->max_time * 1000000.0);
+    }
+
+    pfree(sorted, sizeof(registered_event*) * registered_count, MEMORY_TAG_ARRAY);
+  }
+#endif
+}
+
+void
+event_profiling_update() {
+  if (!state.profiling_enabled || state.report_interval <= 0) {
+    return;
+  }
+
+  f64 now = platform_get_absolute_time();
+  if (now - state.last_report_time >= state.report_interval) {
+    event_profiling_dump();
+    event_profiling_reset();
+    state.last_report_time = now;
+  }
 }
\ No newline at end of file
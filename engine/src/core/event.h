@@ -59,6 +59,34 @@ P_API b8 event_unregister(u16 code, void* listener, PFN_on_event on_event);
 */
 P_API b8 event_fire(u16 code, void* sender, event_context context);
 
+// Set to 0 to compile the dispatch instrumentation out of event_fire entirely
+#ifndef EVENT_PROFILING_ENABLED
+#define EVENT_PROFILING_ENABLED 1
+#endif
+
+/*
+  Turn recording of dispatch statistics on or off at runtime.
+  While enabled, event_fire records per-code fire counts along with
+  per-listener call counts and time spent inside the callback
+  @param enabled - TRUE to start recording, FALSE to stop
+*/
+P_API void event_profiling_set_enabled(b8 enabled);
+
+/*
+  Set how often event_profiling_update logs a summary
+  @param seconds - interval between summaries. 0 disables the periodic summary
+*/
+P_API void event_profiling_set_report_interval(f64 seconds);
+
+// Clear all recorded fire counts and listener timings
+P_API void event_profiling_reset();
+
+// Log the recorded statistics, most expensive listeners first
+P_API void event_profiling_dump();
+
+// Called once per frame. Logs a summary when the report interval has elapsed
+void event_profiling_update();
+
 // System internal event codes. Application should use codes beyond 255.
 // These will only be used within the engine. Application should not use these
 typedef enum system_event_code {
@@ -0,0 +1,170 @@
+#include "frame_pacer.h"
+#include "logger.h"
+#include "core/clock.h"
+#include "core/pmemory.h"
+#include "platform/platform.h"
+#include "platform/platform_atomic.h"
+
+// Spin window used when the config leaves it at 0
+#define FRAME_PACER_DEFAULT_SPIN_US 1000
+
+// Added to a measured oversleep when the spin window has to grow
+#define FRAME_PACER_SPIN_MARGIN_US 200
+
+typedef struct frame_pacer_state {
+  f64 target_fps;
+  // 0 when pacing is off
+  u64 period_ticks;
+  // 0 until the first paced frame sets the schedule
+  u64 next_deadline;
+
+  // Spin window: the configured one, and the current one after adapting to the OS
+  u64 base_spin_ticks;
+  u64 spin_ticks;
+  u64 spin_margin_ticks;
+
+  u64 frames;
+  u64 missed;
+  u64 jitter_total_ticks;
+  u64 jitter_max_ticks;
+  u64 miss_max_ticks;
+  u64 oversleep_max_ticks;
+} frame_pacer_state;
+
+static frame_pacer_state state;
+
+void
+frame_pacer_initialize(frame_pacer_config* config) {
+  pzero_memory(&state, sizeof(state));
+
+  u32 spin_us = config && config->spin_us ? config->spin_us : FRAME_PACER_DEFAULT_SPIN_US;
+  state.base_spin_ticks = clock_ns_to_ticks(spin_us * 1000ULL);
+  state.spin_ticks = state.base_spin_ticks;
+  state.spin_margin_ticks = clock_ns_to_ticks(FRAME_PACER_SPIN_MARGIN_US * 1000ULL);
+
+  frame_pacer_set_target(config ? config->target_fps : 0);
+}
+
+void
+frame_pacer_set_target(f64 target_fps) {
+  if (target_fps > 0) {
+    state.target_fps = target_fps;
+    state.period_ticks = (u64)((f64)platform_get_tick_frequency() / target_fps);
+    P_INFO("Frame pacing at %.2f fps", target_fps);
+  } else {
+    state.target_fps = 0;
+    state.period_ticks = 0;
+  }
+  frame_pacer_restart();
+}
+
+void
+frame_pacer_restart() {
+  state.next_deadline = 0;
+}
+
+f64
+frame_pacer_get_target() {
+  return state.target_fps;
+}
+
+// Keep the spin window just wide enough to cover how late the OS wakes us
+static void
+frame_pacer_adapt_spin(u64 oversleep) {
+  if (oversleep > state.oversleep_max_ticks) {
+    state.oversleep_max_ticks = oversleep;
+  }
+
+  u64 needed = oversleep + state.spin_margin_ticks;
+  u64 limit = state.period_ticks / 2;
+  if (needed > state.spin_ticks) {
+    state.spin_ticks = needed < limit ? needed : limit;
+  } else if (state.spin_ticks > state.base_spin_ticks) {
+    // Ease back toward the configured window once wake-ups improve
+    state.spin_ticks -= (state.spin_ticks - state.base_spin_ticks) / 64;
+  }
+}
+
+void
+frame_pacer_wait() {
+  if (state.period_ticks == 0) {
+    return;
+  }
+
+  u64 now = platform_get_ticks();
+  if (state.next_deadline == 0) {
+    // Nothing to measure the first frame against. Start the schedule here
+    state.next_deadline = now + state.period_ticks;
+    return;
+  }
+
+  u64 deadline = state.next_deadline;
+  state.frames++;
+
+  if (now >= deadline) {
+    // Missed. Restart the schedule from this frame rather than rushing the next ones
+    state.missed++;
+    if (now - deadline > state.miss_max_ticks) {
+      state.miss_max_ticks = now - deadline;
+    }
+    state.next_deadline = now + state.period_ticks;
+    return;
+  }
+
+  if (deadline - now > state.spin_ticks) {
+    u64 wake_time = deadline - state.spin_ticks;
+    platform_sleep_until(wake_time);
+    u64 woke = platform_get_ticks();
+    frame_pacer_adapt_spin(woke > wake_time ? woke - wake_time : 0);
+  }
+
+  while ((now = platform_get_ticks()) < deadline) {
+    platform_cpu_pause();
+  }
+
+  u64 jitter = now - deadline;
+  state.jitter_total_ticks += jitter;
+  if (jitter > state.jitter_max_ticks) {
+    state.jitter_max_ticks = jitter;
+  }
+
+  state.next_deadline = deadline + state.period_ticks;
+}
+
+void
+frame_pacer_get_stats(frame_pacer_stats* out_stats) {
+  out_stats->frames = state.frames;
+  out_stats->missed = state.missed;
+  u64 released = state.frames - state.missed;
+  out_stats->jitter_avg_us = released ? clock_ticks_to_seconds(state.jitter_total_ticks) * 1000000.0 / released : 0;
+  out_stats->jitter_max_us = clock_ticks_to_seconds(state.jitter_max_ticks) * 1000000.0;
+  out_stats->miss_max_us = clock_ticks_to_seconds(state.miss_max_ticks) * 1000000.0;
+  out_stats->oversleep_max_us = clock_ticks_to_seconds(state.oversleep_max_ticks) * 1000000.0;
+  out_stats->spin_us = clock_ticks_to_seconds(state.spin_ticks) * 1000000.0;
+}
+
+void
+frame_pacer_reset_stats() {
+  state.frames = 0;
+  state.missed = 0;
+  state.jitter_total_ticks = 0;
+  state.jitter_max_ticks = 0;
+  state.miss_max_ticks = 0;
+  state.oversleep_max_ticks = 0;
+}
+
+void
+frame_pacer_dump() {
+  frame_pacer_stats stats;
+  frame_pacer_get_stats(&stats);
+  P_INFO("Frame pacing at %.2f fps: %llu frames, %llu missed (worst %.3fms late)",
+    state.target_fps,
+    stats.frames,
+    stats.missed,
+    stats.miss_max_us / 1000.0);
+  P_INFO(" jitter avg %.1fus, max %.1fus. Oversleep max %.1fus, spin window %.1fus",
+    stats.jitter_avg_us,
+    stats.jitter_max_us,
+    stats.oversleep_max_us,
+    stats.spin_us);
+}
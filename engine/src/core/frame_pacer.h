@@ -0,0 +1,67 @@
+/**
+ * Frame pacer
+ *
+ * Holds each frame until its deadline so the main loop runs at a fixed
+ * rate. The thread sleeps until shortly before the deadline, then spins
+ * the rest of the way, which keeps the CPU free without the wake-up
+ * jitter of sleeping all the way.
+ *
+ * Deadlines are spaced one period apart. A frame that finishes after its
+ * deadline counts as missed, and the schedule restarts from that frame
+ * instead of rushing the following frames to catch up.
+*/
+#pragma once
+
+#include "defines.h"
+
+typedef struct frame_pacer_config {
+  // Frames per second to hold the main loop to. 0 leaves the loop uncapped
+  f64 target_fps;
+  // How early to stop sleeping and start spinning, in microseconds.
+  // Grows on its own if the OS wakes the thread later than this. 0 uses a default
+  u32 spin_us;
+} frame_pacer_config;
+
+typedef struct frame_pacer_stats {
+  // Frames paced since the last reset
+  u64 frames;
+  // Frames that finished after their deadline
+  u64 missed;
+  // How long after its deadline a frame was released. Measures the pacer's own error
+  f64 jitter_avg_us;
+  f64 jitter_max_us;
+  // Worst lateness of a missed frame
+  f64 miss_max_us;
+  // Latest the OS has woken the thread past the requested time
+  f64 oversleep_max_us;
+  // Current spin window
+  f64 spin_us;
+} frame_pacer_stats;
+
+// Set up the pacer. The schedule starts with the first call to frame_pacer_wait
+void frame_pacer_initialize(frame_pacer_config* config);
+
+/*
+  Block until the current frame's deadline. Called once at the end of every frame
+  Returns immediately when pacing is off
+*/
+void frame_pacer_wait();
+
+// Start the schedule over from the next frame, after time that belongs to no frame such as a suspend
+void frame_pacer_restart();
+
+/*
+  Change the target rate. The schedule restarts from the next frame
+  @param target_fps - frames per second. 0 turns pacing off
+*/
+P_API void frame_pacer_set_target(f64 target_fps);
+
+P_API f64 frame_pacer_get_target();
+
+P_API void frame_pacer_get_stats(frame_pacer_stats* out_stats);
+
+// Clear jitter and missed deadline counts
+P_API void frame_pacer_reset_stats();
+
+// Log the current statistics
+P_API void frame_pacer_dump();
@@ -0,0 +1,204 @@
+#include "frame_stats.h"
+#include "logger.h"
+#include "core/clock.h"
+#include "core/pmemory.h"
+#include "platform/platform.h"
+
+#include <stdlib.h>
+
+// Widest bar drawn by frame_stats_dump_histogram
+#define FRAME_STATS_HISTOGRAM_WIDTH 40
+
+typedef struct frame_stats_state {
+  // Time spent in each phase during the frame in progress
+  u64 current[FRAME_STATS_PHASE_MAX_PHASES];
+
+  // Ring of finished frames, per phase
+  u64 samples[FRAME_STATS_PHASE_MAX_PHASES][FRAME_STATS_WINDOW];
+  // Histogram of the samples currently in the ring
+  u32 histogram[FRAME_STATS_PHASE_MAX_PHASES][FRAME_STATS_HISTOGRAM_BUCKETS];
+  u64 frame_count;
+
+  // Scratch space for sorting a phase's samples
+  u64 sorted[FRAME_STATS_WINDOW];
+
+  f64 report_interval;
+  f64 last_report_time;
+} frame_stats_state;
+
+static frame_stats_state state;
+
+static const char* phase_names[FRAME_STATS_PHASE_MAX_PHASES] = {
+  "frame",
+  "pump messages",
+  "game update",
+  "game render",
+  "draw frame",
+  "input update",
+  "frame pacing"
+};
+
+void
+frame_stats_initialize() {
+  pzero_memory(&state, sizeof(state));
+}
+
+void
+frame_stats_record(frame_stats_phase phase, u64 ticks) {
+  state.current[phase] += ticks;
+}
+
+u64
+frame_stats_phase_end(frame_stats_phase phase, u64 start_ticks) {
+  u64 now = platform_get_ticks();
+  state.current[phase] += now - start_ticks;
+  return now;
+}
+
+static u32
+frame_stats_bucket(u64 ticks) {
+  u64 us = clock_ticks_to_us(ticks);
+  u32 bucket = 0;
+  while (us > 1 && bucket < FRAME_STATS_HISTOGRAM_BUCKETS - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void
+frame_stats_end_frame() {
+  u32 slot = state.frame_count & (FRAME_STATS_WINDOW - 1);
+  for (u32 phase = 0; phase < FRAME_STATS_PHASE_MAX_PHASES; ++phase) {
+    // Once the window is full, the sample being replaced leaves the histogram
+    if (state.frame_count >= FRAME_STATS_WINDOW) {
+      state.histogram[phase][frame_stats_bucket(state.samples[phase][slot])]--;
+    }
+
+    state.samples[phase][slot] = state.current[phase];
+    state.histogram[phase][frame_stats_bucket(state.current[phase])]++;
+    state.current[phase] = 0;
+  }
+  state.frame_count++;
+
+  if (state.report_interval > 0) {
+    f64 now = platform_get_absolute_time();
+    if (now - state.last_report_time >= state.report_interval) {
+      frame_stats_dump();
+      state.last_report_time = now;
+    }
+  }
+}
+
+u64
+frame_stats_frame_count() {
+  return state.frame_count;
+}
+
+static i32
+frame_stats_compare(const void* a, const void* b) {
+  u64 left = *(const u64*)a;
+  u64 right = *(const u64*)b;
+  return left < right ? -1 : left > right ? 1 : 0;
+}
+
+// Nearest rank percentile of the sorted samples
+static f64
+frame_stats_percentile_ms(u32 count, f64 percentile) {
+  u32 rank = (u32)(percentile * count + 0.999999);
+  if (rank < 1) {
+    rank = 1;
+  }
+  return clock_ticks_to_seconds(state.sorted[rank - 1]) * 1000.0;
+}
+
+b8
+frame_stats_get(frame_stats_phase phase, frame_stats_summary* out_summary) {
+  if (state.frame_count == 0 || phase >= FRAME_STATS_PHASE_MAX_PHASES) {
+    return FALSE;
+  }
+
+  u32 count = state.frame_count < FRAME_STATS_WINDOW ? (u32)state.frame_count : FRAME_STATS_WINDOW;
+  pcopy_memory(state.sorted, state.samples[phase], sizeof(u64) * count);
+  qsort(state.sorted, count, sizeof(u64), frame_stats_compare);
+
+  u64 total = 0;
+  for (u32 i = 0; i < count; ++i) {
+    total += state.sorted[i];
+  }
+
+  out_summary->samples = count;
+  out_summary->avg_ms = clock_ticks_to_seconds(total) * 1000.0 / count;
+  out_summary->p50_ms = frame_stats_percentile_ms(count, 0.50);
+  out_summary->p95_ms = frame_stats_percentile_ms(count, 0.95);
+  out_summary->p99_ms = frame_stats_percentile_ms(count, 0.99);
+  out_summary->max_ms = clock_ticks_to_seconds(state.sorted[count - 1]) * 1000.0;
+  pcopy_memory(out_summary->histogram, state.histogram[phase], sizeof(out_summary->histogram));
+  return TRUE;
+}
+
+const char*
+frame_stats_phase_name(frame_stats_phase phase) {
+  return phase < FRAME_STATS_PHASE_MAX_PHASES ? phase_names[phase] : "unknown";
+}
+
+void
+frame_stats_set_report_interval(f64 seconds) {
+  state.report_interval = seconds;
+  state.last_report_time = platform_get_absolute_time();
+}
+
+void
+frame_stats_dump() {
+  frame_stats_summary summary;
+  if (!frame_stats_get(FRAME_STATS_PHASE_FRAME, &summary)) {
+    P_INFO("Frame stats: no frames recorded");
+    return;
+  }
+
+  P_INFO("Frame times over the last %u of %llu frames (avg / p50 / p95 / p99 / max):", summary.samples, state.frame_count);
+  for (u32 phase = 0; phase < FRAME_STATS_PHASE_MAX_PHASES; ++phase) {
+    frame_stats_get(phase, &summary);
+    P_INFO(" %-14s %8.3fms %8.3fms %8.3fms %8.3fms %8.3fms",
+      phase_names[phase],
+      summary.avg_ms,
+      summary.p50_ms,
+      summary.p95_ms,
+      summary.p99_ms,
+      summary.max_ms);
+  }
+
+  frame_stats_dump_histogram(FRAME_STATS_PHASE_FRAME);
+}
+
+void
+frame_stats_dump_histogram(frame_stats_phase phase) {
+  frame_stats_summary summary;
+  if (!frame_stats_get(phase, &summary)) {
+    return;
+  }
+
+  u32 largest = 0;
+  for (u32 i = 0; i < FRAME_STATS_HISTOGRAM_BUCKETS; ++i) {
+    if (summary.histogram[i] > largest) {
+      largest = summary.histogram[i];
+    }
+  }
+
+  char bar[FRAME_STATS_HISTOGRAM_WIDTH + 1];
+  P_INFO("Histogram of '%s' times:", phase_names[phase]);
+  for (u32 i = 0; i < FRAME_STATS_HISTOGRAM_BUCKETS; ++i) {
+    if (summary.histogram[i] == 0) {
+      continue;
+    }
+
+    // At least one mark so small buckets stay visible
+    u32 width = summary.histogram[i] * FRAME_STATS_HISTOGRAM_WIDTH / largest;
+    width = width ? width : 1;
+    pset_memory(bar, '#', width);
+    bar[width] = 0;
+
+    f64 low_ms = i == 0 ? 0 : (1ULL << i) / 1000.0;
+    P_INFO(" %9.3fms+ %5u %s", low_ms, summary.histogram[i], bar);
+  }
+}
@@ -0,0 +1,79 @@
+/**
+ * Frame time statistics
+ *
+ * Keeps the time each phase of the main loop took over the last
+ * FRAME_STATS_WINDOW frames. Percentiles are computed on request, and a
+ * histogram with power of two buckets is kept up to date as frames come
+ * and go, so tail latency can be read at any time.
+*/
+#pragma once
+
+#include "defines.h"
+
+// Frames kept per phase. Must be a power of 2
+#define FRAME_STATS_WINDOW 1024
+
+// Bucket i counts samples of [2^i, 2^(i+1)) microseconds. Bucket 0 also holds anything under 1us,
+// and the last bucket anything longer
+#define FRAME_STATS_HISTOGRAM_BUCKETS 24
+
+typedef enum frame_stats_phase {
+  // Time from the start of one frame to the start of the next
+  FRAME_STATS_PHASE_FRAME,
+  FRAME_STATS_PHASE_PUMP_MESSAGES,
+  FRAME_STATS_PHASE_GAME_UPDATE,
+  FRAME_STATS_PHASE_GAME_RENDER,
+  FRAME_STATS_PHASE_DRAW_FRAME,
+  FRAME_STATS_PHASE_INPUT_UPDATE,
+  FRAME_STATS_PHASE_FRAME_PACING,
+
+  FRAME_STATS_PHASE_MAX_PHASES
+} frame_stats_phase;
+
+typedef struct frame_stats_summary {
+  // Frames the statistics cover. At most FRAME_STATS_WINDOW
+  u32 samples;
+  f64 avg_ms;
+  f64 p50_ms;
+  f64 p95_ms;
+  f64 p99_ms;
+  f64 max_ms;
+  u32 histogram[FRAME_STATS_HISTOGRAM_BUCKETS];
+} frame_stats_summary;
+
+void frame_stats_initialize();
+
+// Add time to a phase of the current frame. A phase can be added to more than once per frame
+void frame_stats_record(frame_stats_phase phase, u64 ticks);
+
+/*
+  Record the time from start_ticks until now against a phase
+  @returns the current tick count, to start timing the next phase from
+*/
+u64 frame_stats_phase_end(frame_stats_phase phase, u64 start_ticks);
+
+// Close the current frame and add it to the window. Phases not recorded count as 0
+void frame_stats_end_frame();
+
+// Frames recorded since startup
+P_API u64 frame_stats_frame_count();
+
+/*
+  Summarize a phase over the current window
+  @returns FALSE if no frames have been recorded
+*/
+P_API b8 frame_stats_get(frame_stats_phase phase, frame_stats_summary* out_summary);
+
+P_API const char* frame_stats_phase_name(frame_stats_phase phase);
+
+/*
+  Set how often frame_stats_end_frame logs the statistics
+  @param seconds - interval between reports. 0 disables the periodic report
+*/
+P_API void frame_stats_set_report_interval(f64 seconds);
+
+// Log percentiles for every phase, then the histogram of whole frame times
+P_API void frame_stats_dump();
+
+// Log the histogram of a single phase
+P_API void frame_stats_dump_histogram(frame_stats_phase phase);
@@ -0,0 +1,195 @@
+#include "game_module.h"
+#include "game_types.h"
+#include "core/logger.h"
+#include "core/pmemory.h"
+#include "core/pstring.h"
+#include "core/clock.h"
+#include "core/profiler.h"
+#include "platform/platform.h"
+
+#include <stdio.h>
+
+typedef struct game_module_state {
+  b8 loaded;
+  char path[256];
+
+  // The copy the running build was loaded from
+  char loaded_path[272];
+  platform_dynamic_library library;
+  u32 generation;
+
+  // Write time of the build that is running
+  u64 loaded_time;
+  // Write time seen at the last check, while waiting for it to settle
+  u64 pending_time;
+  f64 last_check;
+} game_module_state;
+
+static game_module_state state;
+
+/*
+  Copy the build and load the copy. Two copies alternate, so the next build
+  can be loaded while the current one is still in use
+  @returns FALSE if the build could not be loaded or has no bind export
+*/
+static b8
+game_module_open(platform_dynamic_library* out_library, char* out_path, u64 path_size, PFN_game_module_bind* out_bind) {
+  snprintf(out_path, path_size, "%s.live%u", state.path, state.generation & 1);
+  if (!platform_file_copy(state.path, out_path)) {
+    return FALSE;
+  }
+
+  if (!platform_dynamic_library_load(out_path, out_library)) {
+    platform_file_delete(out_path);
+    return FALSE;
+  }
+
+  *out_bind = (PFN_game_module_bind)platform_dynamic_library_symbol(out_library, GAME_MODULE_BIND_SYMBOL);
+  if (!*out_bind) {
+    P_ERROR("Game module '%s' does not export %s", state.path, GAME_MODULE_BIND_SYMBOL);
+    platform_dynamic_library_unload(out_library);
+    platform_file_delete(out_path);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+// Let go of the running build
+static void
+game_module_close(game* game_inst) {
+  PFN_game_module_unbind unbind = (PFN_game_module_unbind)platform_dynamic_library_symbol(&state.library, GAME_MODULE_UNBIND_SYMBOL);
+  if (unbind) {
+    unbind(game_inst);
+  }
+
+  // Deferred log messages hold pointers to their format strings, which live in the module.
+  // They must all be written, however long that takes
+  log_drain();
+  log_forget_formats();
+  profiler_forget_names();
+
+  platform_dynamic_library_unload(&state.library);
+  platform_file_delete(state.loaded_path);
+}
+
+static b8
+game_module_bind_functions(game* game_inst, PFN_game_module_bind bind, b8 reloaded) {
+  game_inst->initialize = 0;
+  game_inst->update = 0;
+  game_inst->render = 0;
+  game_inst->on_resize = 0;
+
+  if (!bind(game_inst, reloaded)) {
+    P_ERROR("Game module '%s' refused to bind", state.path);
+    return FALSE;
+  }
+
+  if (!game_inst->initialize || !game_inst->update || !game_inst->render || !game_inst->on_resize) {
+    P_ERROR("Game module '%s' left some of the game's function pointers unassigned", state.path);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+b8
+game_module_load(game* game_inst, const char* path) {
+  pzero_memory(&state, sizeof(state));
+  if (string_length(path) >= sizeof(state.path)) {
+    P_ERROR("Game module path '%s' is too long", path);
+    return FALSE;
+  }
+  pcopy_memory(state.path, path, string_length(path) + 1);
+
+  if (!platform_file_write_time(path, &state.loaded_time)) {
+    P_ERROR("Game module '%s' does not exist", path);
+    return FALSE;
+  }
+
+  PFN_game_module_bind bind;
+  if (!game_module_open(&state.library, state.loaded_path, sizeof(state.loaded_path), &bind)) {
+    return FALSE;
+  }
+  state.loaded = TRUE;
+  state.generation++;
+  state.last_check = platform_get_absolute_time();
+
+  P_INFO("Loaded game module '%s'", path);
+  return game_module_bind_functions(game_inst, bind, FALSE);
+}
+
+void
+game_module_unload(game* game_inst) {
+  if (!state.loaded) {
+    return;
+  }
+
+  game_module_close(game_inst);
+  state.loaded = FALSE;
+}
+
+b8
+game_module_reload(game* game_inst) {
+  if (!state.loaded) {
+    return TRUE;
+  }
+
+  u64 write_time = 0;
+  platform_file_write_time(state.path, &write_time);
+
+  // Load the new build before letting go of the old, so a broken build leaves the game running
+  platform_dynamic_library library;
+  char loaded_path[sizeof(state.loaded_path)];
+  PFN_game_module_bind bind;
+  if (!game_module_open(&library, loaded_path, sizeof(loaded_path), &bind)) {
+    P_WARN("Keeping the running build of '%s'", state.path);
+    // Do not try this build again, only the next one
+    state.loaded_time = write_time;
+    return TRUE;
+  }
+
+  u64 start_ticks = platform_get_ticks();
+  game_module_close(game_inst);
+
+  state.library = library;
+  pcopy_memory(state.loaded_path, loaded_path, sizeof(loaded_path));
+  state.loaded_time = write_time;
+  state.generation++;
+
+  if (!game_module_bind_functions(game_inst, bind, TRUE)) {
+    return FALSE;
+  }
+
+  P_INFO("Reloaded game module '%s' in %.2fms", state.path, clock_ticks_to_seconds(platform_get_ticks() - start_ticks) * 1000.0);
+  return TRUE;
+}
+
+b8
+game_module_update(game* game_inst) {
+  if (!state.loaded) {
+    return TRUE;
+  }
+
+  f64 now = platform_get_absolute_time();
+  if (now - state.last_check < GAME_MODULE_CHECK_INTERVAL) {
+    return TRUE;
+  }
+  state.last_check = now;
+
+  // The file may be missing for a moment while the build replaces it
+  u64 write_time;
+  if (!platform_file_write_time(state.path, &write_time) || write_time == state.loaded_time) {
+    state.pending_time = 0;
+    return TRUE;
+  }
+
+  // Wait until the write time holds still for a whole check, so a library
+  // the linker is still writing is not loaded
+  if (write_time != state.pending_time) {
+    state.pending_time = write_time;
+    return TRUE;
+  }
+
+  state.pending_time = 0;
+  return game_module_reload(game_inst);
+}
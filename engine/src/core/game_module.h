@@ -0,0 +1,72 @@
+/**
+ * Game module
+ *
+ * Loads the game's functions from a shared library instead of linking them
+ * into the executable. While the application runs, the library file is
+ * checked for changes between frames. A new build is loaded next to the
+ * old one and the game's function pointers are swapped over to it. Nothing
+ * else is restarted: game.state, the window and every GPU resource are kept.
+ *
+ * The library is always loaded from a copy. That way the build can replace
+ * the file while it is in use, and the loader never hands back the old image
+ * from its cache.
+ *
+ * Only game.state carries over. Static variables in the module start over
+ * with each load. The layout of game.state must not change between builds.
+ * Nothing may point into the module's code or constant data across a
+ * reload: event callbacks must be unregistered in the unbind export, and
+ * jobs started by the game must have finished by the end of the frame.
+*/
+#pragma once
+
+#include "defines.h"
+
+struct game;
+
+// Export every game module defines
+#define GAME_MODULE_BIND_SYMBOL "game_module_bind"
+// Optional export
+#define GAME_MODULE_UNBIND_SYMBOL "game_module_unbind"
+
+// Marks the module's exports. P_API only imports outside the engine
+#ifdef _MSC_VER
+#define GAME_MODULE_EXPORT __declspec(dllexport)
+#else
+#define GAME_MODULE_EXPORT __attribute__((visibility("default")))
+#endif
+
+// How often the library file is checked for changes, in seconds
+#define GAME_MODULE_CHECK_INTERVAL 0.25
+
+/*
+  Assign the game's function pointers to the module's functions
+  @param reloaded - FALSE on the first load. TRUE when a new build replaces
+    a running one, so initialize will not be called again
+  @returns FALSE if the module cannot run with this game
+*/
+typedef b8 (*PFN_game_module_bind)(struct game* game_inst, b8 reloaded);
+
+// Called before the module is unloaded, to drop anything that points into it
+typedef void (*PFN_game_module_unbind)(struct game* game_inst);
+
+/*
+  Load the module and bind the game to it
+  @param path - the shared library the build writes
+*/
+b8 game_module_load(struct game* game_inst, const char* path);
+
+// Unbind the game and unload the module
+void game_module_unload(struct game* game_inst);
+
+/*
+  Reload the module if its file has changed and stopped changing since the
+  last check. Call between frames
+  @returns FALSE if the new build loaded but refused to bind. The game is left without functions
+*/
+b8 game_module_update(struct game* game_inst);
+
+/*
+  Load the current build of the module now, whether or not it has changed
+  @returns FALSE if the new build failed to bind. If it failed to load, the old one stays bound and this returns TRUE
+*/
+b8 game_module_reload(struct game* game_inst);
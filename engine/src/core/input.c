@@ -2,6 +2,7 @@
 #include "core/event.h"
 #include "core/pmemory.h"
 #include "core/logger.h"
+#include "platform/platform.h"
 
 typedef struct keyboard_state {
   b8 keys[256];
@@ -18,6 +19,28 @@ typedef struct input_state {
   keyboard_state keyboard_previous;
   mouse_state mouse_current;
   mouse_state mouse_previous;
+  // Raw motion summed since the last update
+  f32 mouse_delta_x;
+  f32 mouse_delta_y;
+
+  // Ring of this frame's events. event_count keeps counting past capacity
+  input_event events[INPUT_MAX_FRAME_EVENTS];
+  u32 event_count;
+
+  // Presses and releases this frame, and which of them went down or up at least once
+  u8 key_transitions[256];
+  u8 key_pressed[256];
+  u8 key_released[256];
+  u8 button_transitions[BUTTON_MAX_BUTTONS];
+  u8 button_pressed[BUTTON_MAX_BUTTONS];
+  u8 button_released[BUTTON_MAX_BUTTONS];
+
+  // The same as bits, see input_get_packed
+  u64 packed_down[INPUT_PACKED_WORDS];
+  u64 packed_pressed[INPUT_PACKED_WORDS];
+
+  // Set while a recording is replayed, so live input cannot disturb it
+  b8 platform_disabled;
 } input_state;
 
 // Internal input state
@@ -46,16 +69,73 @@ input_update(f64 delta_time) {
   // Copy current state to the previous states
   pcopy_memory(&state.keyboard_previous, &state.keyboard_current, sizeof(keyboard_state));
   pcopy_memory(&state.mouse_previous, &state.mouse_current, sizeof(mouse_state));
+  state.mouse_delta_x = 0;
+  state.mouse_delta_y = 0;
+
+  // Start the next frame's event log
+  state.event_count = 0;
+  pzero_memory(state.key_transitions, sizeof(state.key_transitions));
+  pzero_memory(state.key_pressed, sizeof(state.key_pressed));
+  pzero_memory(state.key_released, sizeof(state.key_released));
+  pzero_memory(state.button_transitions, sizeof(state.button_transitions));
+  pzero_memory(state.button_pressed, sizeof(state.button_pressed));
+  pzero_memory(state.button_released, sizeof(state.button_released));
+  pzero_memory(state.packed_pressed, sizeof(state.packed_pressed));
 }
 
-void
-input_process_key(keys key, b8 pressed) {
+// Add an event to this frame's log, overwriting the oldest once it is full
+static input_event*
+input_record_event(input_event_type type, u32 platform_time) {
+  input_event* event = &state.events[state.event_count & (INPUT_MAX_FRAME_EVENTS - 1)];
+  if (state.event_count == INPUT_MAX_FRAME_EVENTS) {
+    P_WARN("More than %u input events this frame. The oldest are being dropped", INPUT_MAX_FRAME_EVENTS);
+  }
+  state.event_count++;
+
+  pzero_memory(event, sizeof(input_event));
+  event->type = type;
+  event->platform_time = platform_time;
+  event->ticks = platform_get_ticks();
+  return event;
+}
+
+static void
+input_pack(u32 index, b8 pressed) {
+  if (pressed) {
+    state.packed_down[INPUT_PACKED_WORD(index)] |= INPUT_PACKED_BIT(index);
+    state.packed_pressed[INPUT_PACKED_WORD(index)] |= INPUT_PACKED_BIT(index);
+  } else {
+    state.packed_down[INPUT_PACKED_WORD(index)] &= ~INPUT_PACKED_BIT(index);
+  }
+}
+
+// Counts saturate rather than wrap
+static void
+input_count_transition(u8* transitions, u8* pressed_flags, u8* released_flags, u32 index, b8 pressed) {
+  if (transitions[index] < 255) {
+    transitions[index]++;
+  }
+  if (pressed) {
+    pressed_flags[index] = TRUE;
+  } else {
+    released_flags[index] = TRUE;
+  }
+}
+
+static void
+input_apply_key(keys key, b8 pressed, u32 platform_time) {
   // Only handle if the state has actually changed
   if (state.keyboard_current.keys[key] != pressed) {
     P_INFO("GOT TO PROCESS_KEY");
     // Update internal state
     state.keyboard_current.keys[key] = pressed;
 
+    input_event* recorded = input_record_event(INPUT_EVENT_KEY, platform_time);
+    recorded->code = key;
+    recorded->pressed = pressed;
+    input_count_transition(state.key_transitions, state.key_pressed, state.key_released, key, pressed);
+    input_pack(key, pressed);
+
     // Fire an event for immediate processing
     event_context context;
     context.data.u16[0] = key;
@@ -63,12 +143,18 @@ input_process_key(keys key, b8 pressed) {
   }
 }
 
-void
-input_process_button(buttons button, b8 pressed) {
+static void
+input_apply_button(buttons button, b8 pressed, u32 platform_time) {
   // If the state changed, fire an event
   if (state.mouse_current.buttons[button] != pressed) {
     state.mouse_current.buttons[button] = pressed;
 
+    input_event* recorded = input_record_event(INPUT_EVENT_BUTTON, platform_time);
+    recorded->code = button;
+    recorded->pressed = pressed;
+    input_count_transition(state.button_transitions, state.button_pressed, state.button_released, button, pressed);
+    input_pack(INPUT_PACKED_BUTTON_BASE + button, pressed);
+
     // Fire the event
     event_context context;
     context.data.u16[0] = button;
@@ -76,8 +162,8 @@ input_process_button(buttons button, b8 pressed) {
   }
 }
 
-void
-input_process_mouse_move(i16 x, i16 y) {
+static void
+input_apply_mouse_move(i16 x, i16 y, u32 platform_time) {
   // Only process if actually different
   if (state.mouse_current.x != x || state.mouse_current.y != y) {
     /// NOTE: Enable this if debugging
@@ -87,6 +173,10 @@ input_process_mouse_move(i16 x, i16 y) {
     state.mouse_current.x = x;
     state.mouse_current.y = y;
 
+    input_event* recorded = input_record_event(INPUT_EVENT_MOUSE_MOVE, platform_time);
+    recorded->x = x;
+    recorded->y = y;
+
     // Fire the event
     event_context context;
     context.data.u16[0] = x;
@@ -95,9 +185,17 @@ input_process_mouse_move(i16 x, i16 y) {
   }
 }
 
-void
-input_process_mouse_wheel(i8 z_delta) {
+static void
+input_apply_mouse_raw_move(f32 dx, f32 dy) {
+  state.mouse_delta_x += dx;
+  state.mouse_delta_y += dy;
+}
+
+static void
+input_apply_mouse_wheel(i8 z_delta, u32 platform_time) {
   /// NOTE: no internal state to update
+  input_event* recorded = input_record_event(INPUT_EVENT_MOUSE_WHEEL, platform_time);
+  recorded->x = z_delta;
 
   // Fire the event
   event_context context;
@@ -105,6 +203,76 @@ input_process_mouse_wheel(i8 z_delta) {
   event_fire(EVENT_CODE_MOUSE_WHEEL, 0, context);
 }
 
+// Platform entry points. Dropped while a replay owns the input state
+void
+input_process_key(keys key, b8 pressed, u32 platform_time) {
+  if (!state.platform_disabled) {
+    input_apply_key(key, pressed, platform_time);
+  }
+}
+
+void
+input_process_button(buttons button, b8 pressed, u32 platform_time) {
+  if (!state.platform_disabled) {
+    input_apply_button(button, pressed, platform_time);
+  }
+}
+
+void
+input_process_mouse_move(i16 x, i16 y, u32 platform_time) {
+  if (!state.platform_disabled) {
+    input_apply_mouse_move(x, y, platform_time);
+  }
+}
+
+void
+input_process_mouse_raw_move(f32 dx, f32 dy) {
+  if (!state.platform_disabled) {
+    input_apply_mouse_raw_move(dx, dy);
+  }
+}
+
+void
+input_process_mouse_wheel(i8 z_delta, u32 platform_time) {
+  if (!state.platform_disabled) {
+    input_apply_mouse_wheel(z_delta, platform_time);
+  }
+}
+
+void
+input_get_packed(u64* out_down, u64* out_pressed) {
+  pcopy_memory(out_down, state.packed_down, sizeof(state.packed_down));
+  pcopy_memory(out_pressed, state.packed_pressed, sizeof(state.packed_pressed));
+}
+
+void
+input_set_platform_enabled(b8 enabled) {
+  state.platform_disabled = !enabled;
+}
+
+void
+input_replay_event(const input_event* event) {
+  switch (event->type) {
+    case INPUT_EVENT_KEY:
+      input_apply_key((keys)event->code, event->pressed, event->platform_time);
+      break;
+    case INPUT_EVENT_BUTTON:
+      input_apply_button((buttons)event->code, event->pressed, event->platform_time);
+      break;
+    case INPUT_EVENT_MOUSE_MOVE:
+      input_apply_mouse_move(event->x, event->y, event->platform_time);
+      break;
+    case INPUT_EVENT_MOUSE_WHEEL:
+      input_apply_mouse_wheel((i8)event->x, event->platform_time);
+      break;
+  }
+}
+
+void
+input_replay_mouse_delta(f32 dx, f32 dy) {
+  input_apply_mouse_raw_move(dx, dy);
+}
+
 // Key states
 b8
 input_is_key_down(keys key) {
@@ -201,4 +369,63 @@ input_get_previous_mouse_positions(i32* x, i32* y) {
 
   *x = state.mouse_previous.x;
   *y = state.mouse_previous.y;
-}
\ No newline at end of file
+}
+void
+input_get_mouse_delta(f32* dx, f32* dy) {
+  if (!initialized) {
+    *dx = 0;
+    *dy = 0;
+    return;
+  }
+
+  *dx = state.mouse_delta_x;
+  *dy = state.mouse_delta_y;
+}
+
+// Frame event log
+u32
+input_frame_event_count() {
+  return state.event_count < INPUT_MAX_FRAME_EVENTS ? state.event_count : INPUT_MAX_FRAME_EVENTS;
+}
+
+const input_event*
+input_frame_event(u32 index) {
+  u32 count = input_frame_event_count();
+  if (!initialized || index >= count) {
+    return 0;
+  }
+
+  // The oldest kept event sits just past the newest once the ring has wrapped
+  u32 first = state.event_count - count;
+  return &state.events[(first + index) & (INPUT_MAX_FRAME_EVENTS - 1)];
+}
+
+b8
+input_key_pressed_this_frame(keys key) {
+  return initialized && state.key_pressed[key];
+}
+
+b8
+input_key_released_this_frame(keys key) {
+  return initialized && state.key_released[key];
+}
+
+u32
+input_key_transition_count(keys key) {
+  return initialized ? state.key_transitions[key] : 0;
+}
+
+b8
+input_button_pressed_this_frame(buttons button) {
+  return initialized && state.button_pressed[button];
+}
+
+b8
+input_button_released_this_frame(buttons button) {
+  return initialized && state.button_released[button];
+}
+
+u32
+input_button_transition_count(buttons button) {
+  return initialized ? state.button_transitions[button] : 0;
+}
@@ -145,6 +145,33 @@ typedef enum keys {
     KEYS_MAX_KEYS
 } keys;
 
+// Events kept for the frame in progress. Must be a power of 2. Past this the oldest are dropped
+#define INPUT_MAX_FRAME_EVENTS 256
+
+typedef enum input_event_type {
+  INPUT_EVENT_KEY,
+  INPUT_EVENT_BUTTON,
+  INPUT_EVENT_MOUSE_MOVE,
+  INPUT_EVENT_MOUSE_WHEEL
+} input_event_type;
+
+// One input transition, as recorded by the input_process_* functions
+typedef struct input_event {
+  input_event_type type;
+  // Key or button for presses and releases
+  u16 code;
+  b8 pressed;
+  // Mouse position, or the wheel delta in x
+  i16 x;
+  i16 y;
+  // Time the OS stamped the event with, in milliseconds. X server time on
+  // Linux, GetMessageTime on Windows. Only differences are meaningful
+  u32 platform_time;
+  // platform_get_ticks when the engine processed the event. Subtract from a
+  // later tick, such as when the frame is presented, for input latency
+  u64 ticks;
+} input_event;
+
 void input_initialize();
 void input_shutdown();
 void input_update(f64 delta_time);
@@ -155,7 +182,22 @@ P_API b8 input_is_key_up(keys key);
 P_API b8 input_was_key_down(keys key);
 P_API b8 input_was_key_up(keys key);
 
-void input_process_key(keys key, b8 pressed);
+// Events since the last input_update, in the order they happened. A key pressed
+// and released within one frame shows up here and in the transition counts,
+// though input_is_key_down never sees it
+P_API u32 input_frame_event_count();
+// index 0 is the oldest event kept this frame. Returns 0 past the end
+P_API const input_event* input_frame_event(u32 index);
+
+// TRUE if the key went down at any point this frame, even if it is up again
+P_API b8 input_key_pressed_this_frame(keys key);
+// TRUE if the key came up at any point this frame
+P_API b8 input_key_released_this_frame(keys key);
+// Presses and releases of the key this frame. Exact even when events were dropped
+P_API u32 input_key_transition_count(keys key);
+
+// platform_time is the OS timestamp of the event in milliseconds, or 0 if it has none
+void input_process_key(keys key, b8 pressed, u32 platform_time);
 
 // Mouse input
 P_API b8 input_is_button_down(buttons button);
@@ -165,6 +207,38 @@ P_API b8 input_was_button_up(buttons button);
 P_API void input_get_mouse_positions(i32* x, i32* y);
 P_API void input_get_previous_mouse_positions(i32* x, i32* y);
 
-void input_process_button(buttons button, b8 pressed);
-void input_process_mouse_move(i16 x, i16 y);
-void input_process_mouse_wheel(i8 z_delta);
\ No newline at end of file
+P_API b8 input_button_pressed_this_frame(buttons button);
+P_API b8 input_button_released_this_frame(buttons button);
+P_API u32 input_button_transition_count(buttons button);
+
+// Raw mouse motion since the last input_update, in device counts with no
+// pointer acceleration. Keeps counting when the cursor is at the edge of the
+// window or screen. 0 where the platform has no raw input
+P_API void input_get_mouse_delta(f32* dx, f32* dy);
+
+void input_process_button(buttons button, b8 pressed, u32 platform_time);
+void input_process_mouse_move(i16 x, i16 y, u32 platform_time);
+// Add raw motion to this frame's delta. Fires no event: a high rate mouse sends hundreds a frame
+void input_process_mouse_raw_move(f32 dx, f32 dy);
+void input_process_mouse_wheel(i8 z_delta, u32 platform_time);
+
+// Keys and buttons packed one bit each, for testing many at once: key k is
+// bit k, and button b is bit INPUT_PACKED_BUTTON_BASE + b
+#define INPUT_PACKED_BUTTON_BASE 256
+#define INPUT_PACKED_WORDS 5
+#define INPUT_PACKED_BIT(index) (1ULL << ((index) & 63))
+#define INPUT_PACKED_WORD(index) ((index) >> 6)
+
+/*
+  Copy out the packed state
+  @param out_down - INPUT_PACKED_WORDS words, set for everything down now
+  @param out_pressed - INPUT_PACKED_WORDS words, set for everything that went down since the last input_update
+*/
+void input_get_packed(u64* out_down, u64* out_pressed);
+
+// Let the platform's input through, or drop it while a recording is replayed
+void input_set_platform_enabled(b8 enabled);
+// Apply a recorded event as if the platform had just reported it, even while platform input is off
+void input_replay_event(const input_event* event);
+// Apply a frame's recorded raw mouse motion
+void input_replay_mouse_delta(f32 dx, f32 dy);
\ No newline at end of file
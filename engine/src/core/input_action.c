@@ -0,0 +1,181 @@
+#include "input_action.h"
+#include "core/logger.h"
+#include "core/pmemory.h"
+#include "core/pstring.h"
+
+typedef struct input_action_state {
+  // Copied, as the game may register actions from a module that is unloaded later
+  char names[INPUT_MAX_ACTIONS][INPUT_ACTION_MAX_NAME_LENGTH];
+  u32 action_count;
+
+  // Bindings kept packed at the front, as a structure of arrays so the update is one flat loop
+  u64 binding_masks[INPUT_MAX_BINDINGS][INPUT_PACKED_WORDS];
+  u8 binding_actions[INPUT_MAX_BINDINGS];
+  u32 binding_count;
+
+  u64 held;
+  u64 pressed;
+  u64 released;
+} input_action_state;
+
+static b8 initialized = FALSE;
+static input_action_state state;
+
+void
+input_action_initialize() {
+  pzero_memory(&state, sizeof(state));
+  initialized = TRUE;
+}
+
+void
+input_action_shutdown() {
+  initialized = FALSE;
+}
+
+// Bitset of actions with at least one binding fully set in the packed input
+static u64
+input_action_evaluate(const u64* packed) {
+  u64 active = 0;
+  for (u32 i = 0; i < state.binding_count; ++i) {
+    const u64* mask = state.binding_masks[i];
+    u64 missing = 0;
+    for (u32 word = 0; word < INPUT_PACKED_WORDS; ++word) {
+      missing |= mask[word] & ~packed[word];
+    }
+    active |= (u64)(missing == 0) << state.binding_actions[i];
+  }
+  return active;
+}
+
+void
+input_action_update() {
+  if (!initialized) {
+    return;
+  }
+
+  u64 down[INPUT_PACKED_WORDS];
+  u64 went_down[INPUT_PACKED_WORDS];
+  input_get_packed(down, went_down);
+
+  u64 held = input_action_evaluate(down);
+
+  // Counting keys that went down and came back up within the frame as down
+  // catches taps shorter than a frame
+  for (u32 word = 0; word < INPUT_PACKED_WORDS; ++word) {
+    went_down[word] |= down[word];
+  }
+  u64 touched = input_action_evaluate(went_down);
+
+  state.pressed = touched & ~state.held;
+  state.released = state.held & ~held;
+  state.held = held;
+}
+
+u32
+input_action_find(const char* name) {
+  for (u32 i = 0; i < state.action_count; ++i) {
+    if (strings_equal(state.names[i], name)) {
+      return i;
+    }
+  }
+  return INPUT_ACTION_INVALID;
+}
+
+u32
+input_action_register(const char* name) {
+  u32 action = input_action_find(name);
+  if (action != INPUT_ACTION_INVALID) {
+    return action;
+  }
+
+  u64 length = string_length(name);
+  if (length >= INPUT_ACTION_MAX_NAME_LENGTH) {
+    P_ERROR("Cannot register action '%s'. Names are limited to %u characters", name, INPUT_ACTION_MAX_NAME_LENGTH - 1);
+    return INPUT_ACTION_INVALID;
+  }
+  if (state.action_count == INPUT_MAX_ACTIONS) {
+    P_ERROR("Cannot register action '%s'. All %u actions are in use", name, INPUT_MAX_ACTIONS);
+    return INPUT_ACTION_INVALID;
+  }
+
+  action = state.action_count++;
+  pcopy_memory(state.names[action], name, length + 1);
+  return action;
+}
+
+b8
+input_action_bind(u32 action, u32 key_count, const keys* key_list, u32 button_count, const buttons* button_list) {
+  if (action >= state.action_count) {
+    P_ERROR("input_action_bind called with unknown action %u", action);
+    return FALSE;
+  }
+  if (key_count + button_count == 0) {
+    P_ERROR("Cannot bind action '%s' to an empty chord", state.names[action]);
+    return FALSE;
+  }
+  if (state.binding_count == INPUT_MAX_BINDINGS) {
+    P_ERROR("Cannot bind action '%s'. All %u bindings are in use", state.names[action], INPUT_MAX_BINDINGS);
+    return FALSE;
+  }
+
+  u64* mask = state.binding_masks[state.binding_count];
+  pzero_memory(mask, sizeof(u64) * INPUT_PACKED_WORDS);
+  for (u32 i = 0; i < key_count; ++i) {
+    mask[INPUT_PACKED_WORD(key_list[i])] |= INPUT_PACKED_BIT(key_list[i]);
+  }
+  for (u32 i = 0; i < button_count; ++i) {
+    u32 index = INPUT_PACKED_BUTTON_BASE + button_list[i];
+    mask[INPUT_PACKED_WORD(index)] |= INPUT_PACKED_BIT(index);
+  }
+
+  state.binding_actions[state.binding_count] = (u8)action;
+  state.binding_count++;
+  return TRUE;
+}
+
+void
+input_action_unbind_all(u32 action) {
+  // Keep the bindings packed by moving the survivors down over the removed ones
+  u32 kept = 0;
+  for (u32 i = 0; i < state.binding_count; ++i) {
+    if (state.binding_actions[i] == action) {
+      continue;
+    }
+    if (kept != i) {
+      pcopy_memory(state.binding_masks[kept], state.binding_masks[i], sizeof(u64) * INPUT_PACKED_WORDS);
+      state.binding_actions[kept] = state.binding_actions[i];
+    }
+    kept++;
+  }
+  state.binding_count = kept;
+}
+
+u64
+input_actions_pressed() {
+  return state.pressed;
+}
+
+u64
+input_actions_held() {
+  return state.held;
+}
+
+u64
+input_actions_released() {
+  return state.released;
+}
+
+b8
+input_action_pressed(u32 action) {
+  return action < INPUT_MAX_ACTIONS && (state.pressed & INPUT_ACTION_BIT(action)) != 0;
+}
+
+b8
+input_action_held(u32 action) {
+  return action < INPUT_MAX_ACTIONS && (state.held & INPUT_ACTION_BIT(action)) != 0;
+}
+
+b8
+input_action_released(u32 action) {
+  return action < INPUT_MAX_ACTIONS && (state.released & INPUT_ACTION_BIT(action)) != 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * Input actions
+ *
+ * Named actions bound to keys and buttons, so game code asks for "jump"
+ * rather than for the space bar. A binding is a chord: every key and
+ * button in it must be down. An action may have several bindings, and is
+ * active while any of them is.
+ *
+ * Each binding is compiled to a mask over the packed key and button bits
+ * (see input_get_packed). Once per frame, after messages are pumped, all
+ * bindings are tested against the packed state with a few AND and compare
+ * operations each, and the results are kept as bitsets with one bit per action.
+ *
+ * A press and release shorter than a frame still reports the action as
+ * pressed for that frame, though it is never held.
+*/
+#pragma once
+
+#include "defines.h"
+#include "core/input.h"
+
+// Actions that can be registered. One bit each in the result bitsets
+#define INPUT_MAX_ACTIONS 64
+
+// Bindings across every action
+#define INPUT_MAX_BINDINGS 256
+
+// Longest action name, terminator included
+#define INPUT_ACTION_MAX_NAME_LENGTH 32
+
+// Returned when an action cannot be registered or found
+#define INPUT_ACTION_INVALID 0xFFFFFFFF
+
+// Bit of an action in the result bitsets
+#define INPUT_ACTION_BIT(action) (1ULL << (action))
+
+void input_action_initialize();
+void input_action_shutdown();
+
+// Evaluate every action against the current input. Call once per frame, after pumping messages
+void input_action_update();
+
+/*
+  Register an action, or find it if it already exists
+  @param name - copied. Shorter than INPUT_ACTION_MAX_NAME_LENGTH
+  @returns the action's id, or INPUT_ACTION_INVALID if the name is too long or INPUT_MAX_ACTIONS are registered
+*/
+P_API u32 input_action_register(const char* name);
+
+// Id of a registered action, or INPUT_ACTION_INVALID
+P_API u32 input_action_find(const char* name);
+
+/*
+  Add a binding to an action. The action is active while all of the given keys and buttons are down
+  @param key_count - keys in the chord. keys may be 0 when this is 0
+  @param button_count - mouse buttons in the chord. buttons may be 0 when this is 0
+  @returns FALSE if the action does not exist, the chord is empty or INPUT_MAX_BINDINGS are in use
+*/
+P_API b8 input_action_bind(u32 action, u32 key_count, const keys* key_list, u32 button_count, const buttons* button_list);
+
+// Remove every binding of an action
+P_API void input_action_unbind_all(u32 action);
+
+// Actions that became active this frame, one bit per action id
+P_API u64 input_actions_pressed();
+// Actions active now
+P_API u64 input_actions_held();
+// Actions that stopped being active this frame
+P_API u64 input_actions_released();
+
+P_API b8 input_action_pressed(u32 action);
+P_API b8 input_action_held(u32 action);
+P_API b8 input_action_released(u32 action);
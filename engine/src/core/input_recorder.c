@@ -0,0 +1,262 @@
+#include "input_recorder.h"
+#include "core/input.h"
+#include "core/logger.h"
+#include "core/pmemory.h"
+#include "platform/platform.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INPUT_RECORD_MAGIC 0x52494750 // "PGIR"
+#define INPUT_RECORD_VERSION 1
+
+// Frames are gathered here and appended to the file when it fills
+#define INPUT_RECORDER_BUFFER_SIZE (64 * 1024)
+
+typedef struct input_record_header {
+  u32 magic;
+  u32 version;
+} input_record_header;
+
+typedef struct input_record_frame {
+  u64 frame_ns;
+  // Raw mouse motion summed over the frame
+  f32 mouse_dx;
+  f32 mouse_dy;
+  u32 event_count;
+  u32 reserved;
+} input_record_frame;
+
+typedef struct input_record_event {
+  u8 type;
+  u8 pressed;
+  u16 code;
+  i16 x;
+  i16 y;
+  u32 platform_time;
+} input_record_event;
+
+STATIC_ASSERT(sizeof(input_record_frame) == 24, "input_record_frame must have no padding.");
+STATIC_ASSERT(sizeof(input_record_event) == 12, "input_record_event must have no padding.");
+
+// Largest a single frame can take in the file
+#define INPUT_RECORD_MAX_FRAME_SIZE (sizeof(input_record_frame) + INPUT_MAX_FRAME_EVENTS * sizeof(input_record_event))
+
+typedef struct input_recorder_state {
+  input_recorder_mode mode;
+  platform_file file;
+  u64 frame_count;
+
+  // Recording: frames not yet appended to the file
+  u8* buffer;
+  u64 buffer_used;
+
+  // Replay: the whole file, mapped
+  u8* data;
+  u64 size;
+  u64 offset;
+} input_recorder_state;
+
+static input_recorder_state state;
+
+static b8
+input_recorder_flush() {
+  if (state.buffer_used == 0) {
+    return TRUE;
+  }
+
+  b8 result = platform_file_append(&state.file, state.buffer, state.buffer_used);
+  if (!result) {
+    P_ERROR("Failed to write %llu bytes of input recording", state.buffer_used);
+  }
+  state.buffer_used = 0;
+  return result;
+}
+
+static b8
+input_recorder_open_record(const char* path) {
+  if (!platform_file_open(path, TRUE, &state.file)) {
+    P_ERROR("Unable to create input recording '%s'", path);
+    return FALSE;
+  }
+
+  state.buffer = pallocate(INPUT_RECORDER_BUFFER_SIZE, MEMORY_TAG_APPLICATION);
+  input_record_header header = {INPUT_RECORD_MAGIC, INPUT_RECORD_VERSION};
+  pcopy_memory(state.buffer, &header, sizeof(header));
+  state.buffer_used = sizeof(header);
+
+  P_INFO("Recording input to '%s'", path);
+  return TRUE;
+}
+
+static b8
+input_recorder_open_replay(const char* path) {
+  if (!platform_file_open(path, FALSE, &state.file)) {
+    P_ERROR("Unable to open input recording '%s'", path);
+    return FALSE;
+  }
+
+  state.size = platform_file_size(&state.file);
+  state.data = state.size >= sizeof(input_record_header) ? platform_file_map(&state.file, 0, state.size) : 0;
+  if (!state.data) {
+    P_ERROR("Input recording '%s' is empty or could not be mapped", path);
+    platform_file_close(&state.file);
+    return FALSE;
+  }
+
+  input_record_header* header = (input_record_header*)state.data;
+  if (header->magic != INPUT_RECORD_MAGIC || header->version != INPUT_RECORD_VERSION) {
+    P_ERROR("'%s' is not a version %u input recording", path, INPUT_RECORD_VERSION);
+    platform_file_unmap(state.data, state.size);
+    platform_file_close(&state.file);
+    state.data = 0;
+    return FALSE;
+  }
+  state.offset = sizeof(input_record_header);
+
+  // Live input would make the run differ from the recording
+  input_set_platform_enabled(FALSE);
+  P_INFO("Replaying input from '%s'", path);
+  return TRUE;
+}
+
+b8
+input_recorder_initialize(input_recorder_config* config) {
+  pzero_memory(&state, sizeof(state));
+
+  input_recorder_mode mode = config->mode;
+  const char* path = config->path;
+  const char* record_path = getenv(INPUT_RECORD_ENV);
+  const char* replay_path = getenv(INPUT_REPLAY_ENV);
+  if (replay_path && replay_path[0]) {
+    mode = INPUT_RECORDER_MODE_REPLAY;
+    path = replay_path;
+  } else if (record_path && record_path[0]) {
+    mode = INPUT_RECORDER_MODE_RECORD;
+    path = record_path;
+  }
+
+  if (mode == INPUT_RECORDER_MODE_OFF) {
+    return TRUE;
+  }
+  if (!path || !path[0]) {
+    P_ERROR("Input recorder has no file to use");
+    return FALSE;
+  }
+
+  b8 opened = mode == INPUT_RECORDER_MODE_RECORD ? input_recorder_open_record(path) : input_recorder_open_replay(path);
+  if (opened) {
+    state.mode = mode;
+  }
+  return opened;
+}
+
+void
+input_recorder_shutdown() {
+  if (state.mode == INPUT_RECORDER_MODE_RECORD) {
+    input_recorder_flush();
+    pfree(state.buffer, INPUT_RECORDER_BUFFER_SIZE, MEMORY_TAG_APPLICATION);
+    platform_file_close(&state.file);
+    P_INFO("Recorded %llu frames of input", state.frame_count);
+  } else if (state.mode == INPUT_RECORDER_MODE_REPLAY) {
+    platform_file_unmap(state.data, state.size);
+    platform_file_close(&state.file);
+    input_set_platform_enabled(TRUE);
+    P_INFO("Replayed %llu frames of input", state.frame_count);
+  }
+
+  pzero_memory(&state, sizeof(state));
+}
+
+input_recorder_mode
+input_recorder_get_mode() {
+  return state.mode;
+}
+
+void
+input_recorder_end_frame(u64 frame_ns) {
+  if (state.mode != INPUT_RECORDER_MODE_RECORD) {
+    return;
+  }
+
+  if (state.buffer_used + INPUT_RECORD_MAX_FRAME_SIZE > INPUT_RECORDER_BUFFER_SIZE) {
+    input_recorder_flush();
+  }
+
+  input_record_frame* frame = (input_record_frame*)(state.buffer + state.buffer_used);
+  frame->frame_ns = frame_ns;
+  input_get_mouse_delta(&frame->mouse_dx, &frame->mouse_dy);
+  frame->event_count = input_frame_event_count();
+  frame->reserved = 0;
+
+  input_record_event* records = (input_record_event*)(frame + 1);
+  for (u32 i = 0; i < frame->event_count; ++i) {
+    const input_event* event = input_frame_event(i);
+    records[i].type = (u8)event->type;
+    records[i].pressed = event->pressed;
+    records[i].code = event->code;
+    records[i].x = event->x;
+    records[i].y = event->y;
+    records[i].platform_time = event->platform_time;
+  }
+
+  state.buffer_used += sizeof(input_record_frame) + frame->event_count * sizeof(input_record_event);
+  state.frame_count++;
+}
+
+// Events index the input state by code, so one out of range would write past it
+static b8
+input_recorder_event_valid(const input_record_event* record) {
+  switch (record->type) {
+    case INPUT_EVENT_KEY:
+      return record->code < 256;
+    case INPUT_EVENT_BUTTON:
+      return record->code < BUTTON_MAX_BUTTONS;
+    case INPUT_EVENT_MOUSE_MOVE:
+    case INPUT_EVENT_MOUSE_WHEEL:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+b8
+input_recorder_next_frame(u64* out_frame_ns) {
+  if (state.mode != INPUT_RECORDER_MODE_REPLAY || state.size - state.offset < sizeof(input_record_frame)) {
+    return FALSE;
+  }
+
+  input_record_frame* frame = (input_record_frame*)(state.data + state.offset);
+  u64 frame_size = sizeof(input_record_frame) + (u64)frame->event_count * sizeof(input_record_event);
+  if (frame->event_count > INPUT_MAX_FRAME_EVENTS || state.size - state.offset < frame_size) {
+    P_WARN("Input recording is truncated after %llu frames", state.frame_count);
+    return FALSE;
+  }
+
+  // Check the whole frame before replaying any of it
+  input_record_event* records = (input_record_event*)(frame + 1);
+  for (u32 i = 0; i < frame->event_count; ++i) {
+    if (!input_recorder_event_valid(&records[i])) {
+      P_WARN("Input recording is corrupt after %llu frames", state.frame_count);
+      return FALSE;
+    }
+  }
+
+  for (u32 i = 0; i < frame->event_count; ++i) {
+    input_event event;
+    pzero_memory(&event, sizeof(event));
+    event.type = (input_event_type)records[i].type;
+    event.pressed = records[i].pressed;
+    event.code = records[i].code;
+    event.x = records[i].x;
+    event.y = records[i].y;
+    event.platform_time = records[i].platform_time;
+    input_replay_event(&event);
+  }
+  input_replay_mouse_delta(frame->mouse_dx, frame->mouse_dy);
+
+  state.offset += frame_size;
+  state.frame_count++;
+  *out_frame_ns = frame->frame_ns;
+  return TRUE;
+}
@@ -0,0 +1,60 @@
+/**
+ * Input recorder
+ *
+ * Records a session to a file: for each frame, its length and the input
+ * events the platform reported during it. Replaying the file feeds the
+ * same events back through the input system, frame by frame, while live
+ * input is ignored. The game is handed the recorded frame lengths instead
+ * of measured ones, so it steps through the same simulation however fast
+ * the build under test draws. Frame stats still measure real time, which
+ * makes runs of different builds directly comparable.
+ *
+ * File layout, in the writer's byte order:
+ *  - input_record_header
+ *  - per frame: an input_record_frame, then event_count input_record_events
+*/
+#pragma once
+
+#include "defines.h"
+
+// Environment variables that turn on recording or replay to the given path, overriding the config
+#define INPUT_RECORD_ENV "PEGASUS_RECORD_INPUT"
+#define INPUT_REPLAY_ENV "PEGASUS_REPLAY_INPUT"
+
+typedef enum input_recorder_mode {
+  INPUT_RECORDER_MODE_OFF,
+  INPUT_RECORDER_MODE_RECORD,
+  INPUT_RECORDER_MODE_REPLAY
+} input_recorder_mode;
+
+typedef struct input_recorder_config {
+  input_recorder_mode mode;
+  // File to record to or replay from
+  const char* path;
+} input_recorder_config;
+
+/*
+  Open the recording. Call after input_initialize
+  @param config - mode and path. Zeroed for off, unless an environment variable asks for one
+  @returns FALSE if the file could not be opened or is not a recording
+*/
+b8 input_recorder_initialize(input_recorder_config* config);
+
+// Write out what is left of a recording, and close the file
+void input_recorder_shutdown();
+
+P_API input_recorder_mode input_recorder_get_mode();
+
+/*
+  Record the frame that is ending: its events and raw mouse motion as the
+  input system holds them now. Call before input_update clears them
+  @param frame_ns - length of the frame handed to the game
+*/
+void input_recorder_end_frame(u64 frame_ns);
+
+/*
+  Feed the next recorded frame's events to the input system. Call after pumping messages
+  @param out_frame_ns - length of the frame as recorded
+  @returns FALSE once every frame has been replayed
+*/
+b8 input_recorder_next_frame(u64* out_frame_ns);
@@ -0,0 +1,1010 @@
+#include "job_system.h"
+#include "logger.h"
+#include "core/pmemory.h"
+#include "core/profiler.h"
+#include "platform/platform.h"
+#include "platform/platform_atomic.h"
+
+#include <stdio.h>
+
+// Failed attempts to find work before an idle worker goes to sleep
+#define JOB_IDLE_SPINS 256
+
+// Failed attempts to find work in job_wait before the thread yields its core
+#define JOB_WAIT_SPINS 64
+
+// Chunks job_parallel_for aims to hand each thread, so threads that finish early can take over from slow ones
+#define JOB_CHUNKS_PER_THREAD 4
+
+#define JOB_QUEUE_MASK (JOB_QUEUE_CAPACITY - 1)
+
+typedef struct job {
+  job_desc desc;
+  job_counter* counter;
+} job;
+
+// A deque slot. A thief may read a slot while its owner reuses it (the thief then
+// loses the race on top and drops what it read), so every field is accessed atomically
+typedef struct job_slot {
+  void* entry;
+  void* params;
+  void* name;
+  void* counter;
+} job_slot;
+
+// Chase-Lev deque. The owner pushes and pops at bottom, thieves take from top.
+// top and bottom sit on separate cache lines so thieves do not slow the owner down
+typedef struct job_queue {
+  i64 top;
+  u8 top_padding[56];
+  i64 bottom;
+  u8 bottom_padding[56];
+  job_slot slots[JOB_QUEUE_CAPACITY];
+} job_queue;
+
+// A pool fiber. Each one runs the scheduling loop, and the jobs it finds on its own stack
+typedef struct job_fiber {
+  platform_fiber fiber;
+  // Profile zone of the job running on the fiber. Closed while the fiber is parked,
+  // since the fiber may resume on another thread
+  const char* zone;
+  // Next fiber in the free list or the ready list
+  struct job_fiber* next;
+} job_fiber;
+
+// A job, or a parked fiber, held back until a counter reaches 0
+typedef struct job_deferred {
+  job job;
+  // Set when this is a parked fiber rather than a job
+  job_fiber* fiber;
+  struct job_deferred* next;
+} job_deferred;
+
+// The main thread and every worker
+typedef struct job_thread {
+  platform_thread thread;
+  char name[16];
+  b8 worker;
+  // Logical processors the thread is pinned to. 0 when it is not pinned
+  u64 affinity;
+  job_queue* queue;
+  // Picks the first queue the thread tries to steal from, so thieves spread out
+  u32 steal_seed;
+
+  // The thread's own context, which it returns to when it has no more use for pool fibers
+  platform_fiber context;
+  // Pool fiber running on the thread. 0 while it is in its own context
+  job_fiber* running;
+  // Fiber a worker starts on, set aside before the thread starts so the pool cannot run dry first
+  job_fiber* first_fiber;
+  // Counter the thread's own context waits on in job_wait
+  job_counter* home_wait;
+
+  // Left by a fiber switching away, for whatever runs next on the thread to deal with.
+  // previous goes back to the pool, or parks on park_counter when that is set
+  job_fiber* previous;
+  job_counter* park_counter;
+} job_thread;
+
+typedef struct job_system_state {
+  b8 initialized;
+  b8 running;
+  u32 worker_count;
+
+  platform_cpu_topology topology;
+  b8 topology_known;
+  // Threads are pinned one per physical core: the main thread on the first,
+  // then the reserved cores, then the workers
+  b8 pinning;
+  u32 reserved_cores;
+
+  // The main thread first, then the workers
+  u32 thread_count;
+  job_thread threads[JOB_MAX_WORKERS + 1];
+
+  // Idle workers sleep on the semaphore. sleeping counts them, so submitters
+  // only signal when a worker is actually asleep
+  platform_semaphore wake;
+  u32 sleeping;
+
+  // Guards the deferred pool, the waiting list of every counter, and the fiber lists
+  platform_mutex lock;
+  job_deferred* free_deferred;
+  job_deferred deferred[JOB_MAX_DEFERRED];
+
+  b8 fibers_enabled;
+  u32 fiber_capacity;
+  // Fibers actually created
+  u32 fiber_count;
+  job_fiber* fibers;
+  job_fiber* free_fibers;
+  // Parked fibers whose counter reached 0, oldest first
+  job_fiber* ready_head;
+  job_fiber* ready_tail;
+  u32 ready_count;
+} job_system_state;
+
+static job_system_state state;
+
+// 0 on threads outside the job system
+static _Thread_local job_thread* current_thread;
+
+/*
+  Fibers move between threads, and a compiler may keep the address of a
+  thread local in a register across a call that switches fibers. Every read
+  goes through here so it is fetched fresh on whatever thread is running
+*/
+static __attribute__((noinline)) job_thread*
+job_current_thread() {
+  return current_thread;
+}
+
+static void
+job_slot_write(job_slot* slot, const job* item) {
+  platform_atomic_store_ptr(&slot->entry, (void*)item->desc.entry, PLATFORM_MEMORY_ORDER_RELAXED);
+  platform_atomic_store_ptr(&slot->params, item->desc.params, PLATFORM_MEMORY_ORDER_RELAXED);
+  platform_atomic_store_ptr(&slot->name, (void*)item->desc.name, PLATFORM_MEMORY_ORDER_RELAXED);
+  platform_atomic_store_ptr(&slot->counter, item->counter, PLATFORM_MEMORY_ORDER_RELAXED);
+}
+
+static void
+job_slot_read(job_slot* slot, job* out_item) {
+  out_item->desc.entry = (PFN_job_entry)platform_atomic_load_ptr(&slot->entry, PLATFORM_MEMORY_ORDER_RELAXED);
+  out_item->desc.params = platform_atomic_load_ptr(&slot->params, PLATFORM_MEMORY_ORDER_RELAXED);
+  out_item->desc.name = platform_atomic_load_ptr(&slot->name, PLATFORM_MEMORY_ORDER_RELAXED);
+  out_item->counter = platform_atomic_load_ptr(&slot->counter, PLATFORM_MEMORY_ORDER_RELAXED);
+}
+
+// Owner only
+static b8
+job_queue_push(job_queue* queue, const job* item) {
+  i64 bottom = platform_atomic_load_i64(&queue->bottom, PLATFORM_MEMORY_ORDER_RELAXED);
+  i64 top = platform_atomic_load_i64(&queue->top, PLATFORM_MEMORY_ORDER_ACQUIRE);
+  if (bottom - top >= JOB_QUEUE_CAPACITY) {
+    return FALSE;
+  }
+
+  job_slot_write(&queue->slots[bottom & JOB_QUEUE_MASK], item);
+  // Publishes the slot to thieves
+  platform_atomic_store_i64(&queue->bottom, bottom + 1, PLATFORM_MEMORY_ORDER_RELEASE);
+  return TRUE;
+}
+
+// Owner only. Takes the newest job
+static b8
+job_queue_pop(job_queue* queue, job* out_item) {
+  i64 bottom = platform_atomic_load_i64(&queue->bottom, PLATFORM_MEMORY_ORDER_RELAXED) - 1;
+  platform_atomic_store_i64(&queue->bottom, bottom, PLATFORM_MEMORY_ORDER_RELAXED);
+  // Thieves must see bottom lowered before top is read, or the owner and a thief could both take the last job
+  platform_atomic_thread_fence(PLATFORM_MEMORY_ORDER_SEQ_CST);
+  i64 top = platform_atomic_load_i64(&queue->top, PLATFORM_MEMORY_ORDER_RELAXED);
+
+  if (top > bottom) {
+    // Empty
+    platform_atomic_store_i64(&queue->bottom, bottom + 1, PLATFORM_MEMORY_ORDER_RELAXED);
+    return FALSE;
+  }
+
+  job_slot_read(&queue->slots[bottom & JOB_QUEUE_MASK], out_item);
+  if (top < bottom) {
+    return TRUE;
+  }
+
+  // Last job. Thieves may be after it too, so claim it through top the way they do
+  b8 won = platform_atomic_compare_exchange_i64(&queue->top, &top, top + 1, PLATFORM_MEMORY_ORDER_SEQ_CST);
+  platform_atomic_store_i64(&queue->bottom, bottom + 1, PLATFORM_MEMORY_ORDER_RELAXED);
+  return won;
+}
+
+// Any thread. Takes the oldest job
+static b8
+job_queue_steal(job_queue* queue, job* out_item) {
+  i64 top = platform_atomic_load_i64(&queue->top, PLATFORM_MEMORY_ORDER_ACQUIRE);
+  platform_atomic_thread_fence(PLATFORM_MEMORY_ORDER_SEQ_CST);
+  i64 bottom = platform_atomic_load_i64(&queue->bottom, PLATFORM_MEMORY_ORDER_ACQUIRE);
+  if (top >= bottom) {
+    return FALSE;
+  }
+
+  job_slot_read(&queue->slots[top & JOB_QUEUE_MASK], out_item);
+  // Fails if the owner or another thief took the job since top was read
+  return platform_atomic_compare_exchange_i64(&queue->top, &top, top + 1, PLATFORM_MEMORY_ORDER_SEQ_CST);
+}
+
+static b8
+job_queue_empty(job_queue* queue) {
+  i64 top = platform_atomic_load_i64(&queue->top, PLATFORM_MEMORY_ORDER_ACQUIRE);
+  i64 bottom = platform_atomic_load_i64(&queue->bottom, PLATFORM_MEMORY_ORDER_ACQUIRE);
+  return top >= bottom;
+}
+
+// The thread's own deque first, then steal from the others
+static b8
+job_find(job_thread* thread, job* out_item) {
+  if (thread && job_queue_pop(thread->queue, out_item)) {
+    return TRUE;
+  }
+
+  u32 count = state.thread_count;
+  if (count == 0) {
+    return FALSE;
+  }
+
+  // xorshift
+  u32 seed = thread ? thread->steal_seed : (u32)platform_get_ticks() | 1;
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  if (thread) {
+    thread->steal_seed = seed;
+  }
+
+  for (u32 i = 0; i < count; ++i) {
+    job_thread* victim = &state.threads[(seed + i) % count];
+    if (victim != thread && job_queue_steal(victim->queue, out_item)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+// Wake up to count sleeping workers
+static void
+job_wake_workers(u32 count) {
+  // Pairs with the fence in job_worker_sleep: either the worker sees the new work, or this sees the worker asleep
+  platform_atomic_thread_fence(PLATFORM_MEMORY_ORDER_SEQ_CST);
+  u32 sleeping = platform_atomic_load_u32(&state.sleeping, PLATFORM_MEMORY_ORDER_RELAXED);
+  while (count > 0 && sleeping > 0) {
+    if (platform_atomic_compare_exchange_u32(&state.sleeping, &sleeping, sleeping - 1, PLATFORM_MEMORY_ORDER_SEQ_CST)) {
+      platform_semaphore_signal(&state.wake);
+      sleeping--;
+      count--;
+    }
+  }
+}
+
+// Queue a fiber to be resumed by the next thread looking for work. Lock held
+static void
+job_fiber_ready_locked(job_fiber* fiber) {
+  fiber->next = 0;
+  if (state.ready_tail) {
+    state.ready_tail->next = fiber;
+  } else {
+    state.ready_head = fiber;
+  }
+  state.ready_tail = fiber;
+  platform_atomic_fetch_add_u32(&state.ready_count, 1, PLATFORM_MEMORY_ORDER_RELEASE);
+}
+
+static job_fiber*
+job_fiber_take_ready() {
+  if (platform_atomic_load_u32(&state.ready_count, PLATFORM_MEMORY_ORDER_ACQUIRE) == 0) {
+    return 0;
+  }
+
+  platform_mutex_lock(&state.lock);
+  job_fiber* fiber = state.ready_head;
+  if (fiber) {
+    state.ready_head = fiber->next;
+    if (!state.ready_head) {
+      state.ready_tail = 0;
+    }
+    platform_atomic_fetch_sub_u32(&state.ready_count, 1, PLATFORM_MEMORY_ORDER_RELAXED);
+  }
+  platform_mutex_unlock(&state.lock);
+  return fiber;
+}
+
+static job_fiber*
+job_fiber_acquire() {
+  platform_mutex_lock(&state.lock);
+  job_fiber* fiber = state.free_fibers;
+  if (fiber) {
+    state.free_fibers = fiber->next;
+  }
+  platform_mutex_unlock(&state.lock);
+  return fiber;
+}
+
+static void
+job_fiber_release(job_fiber* fiber) {
+  fiber->zone = 0;
+  platform_mutex_lock(&state.lock);
+  fiber->next = state.free_fibers;
+  state.free_fibers = fiber;
+  platform_mutex_unlock(&state.lock);
+}
+
+// Hang a fiber that switched away off its counter, or make it ready if the counter is already done
+static void
+job_fiber_park(job_fiber* fiber, job_counter* counter) {
+  b8 parked = FALSE;
+  platform_mutex_lock(&state.lock);
+  // Checked under the lock, which job_counter_finish holds while the counter reaches 0
+  if (!job_counter_done(counter) && state.free_deferred) {
+    job_deferred* node = state.free_deferred;
+    state.free_deferred = node->next;
+    node->fiber = fiber;
+    node->next = counter->waiting;
+    counter->waiting = node;
+    parked = TRUE;
+  }
+  if (!parked) {
+    // With no room to park, the fiber goes around again and checks its counter once more
+    job_fiber_ready_locked(fiber);
+  }
+  platform_mutex_unlock(&state.lock);
+
+  if (!parked) {
+    job_wake_workers(1);
+  }
+}
+
+// Run by whatever gains control of a thread after a switch: deal with the fiber that left
+static void
+job_switched_in(job_fiber* self) {
+  job_thread* thread = job_current_thread();
+  job_fiber* previous = thread->previous;
+  job_counter* park_counter = thread->park_counter;
+  thread->running = self;
+  thread->previous = 0;
+  thread->park_counter = 0;
+
+  if (!previous) {
+    return;
+  }
+  if (park_counter) {
+    job_fiber_park(previous, park_counter);
+  } else {
+    job_fiber_release(previous);
+  }
+}
+
+/*
+  Switch from a pool fiber to another context. The fiber goes back to the
+  pool, or parks on park_counter. Returns once the fiber is switched to
+  again, which may be on another thread
+*/
+static void
+job_fiber_switch(job_fiber* self, platform_fiber* to, job_counter* park_counter) {
+  job_thread* thread = job_current_thread();
+  thread->previous = self;
+  thread->park_counter = park_counter;
+  platform_fiber_switch(&self->fiber, to);
+  job_switched_in(self);
+}
+
+static void job_execute(job* item);
+
+// Queue a job on the calling thread's deque, or run it here if there is none or it is full
+static b8
+job_submit(const job* item) {
+  job_thread* thread = job_current_thread();
+  if (thread && job_queue_push(thread->queue, item)) {
+    return TRUE;
+  }
+
+  job copy = *item;
+  job_execute(&copy);
+  return FALSE;
+}
+
+/*
+  Bring a counter from 1 to 0, then queue the jobs and resume the fibers
+  waiting on it. Holding the lock keeps job_run_after and parking fibers
+  from adding to the waiting list while it is taken. Nothing touches the
+  counter once it reads 0, since its owner may return from job_wait and
+  release it
+*/
+static void
+job_counter_finish(job_counter* counter) {
+  if (!state.initialized) {
+    // Nothing can be waiting without the job system
+    platform_atomic_fetch_sub_i64(&counter->value, 1, PLATFORM_MEMORY_ORDER_ACQ_REL);
+    return;
+  }
+
+  u32 resumed = 0;
+  job_deferred* jobs = 0;
+  platform_mutex_lock(&state.lock);
+  job_deferred* waiting = counter->waiting;
+  counter->waiting = 0;
+  if (platform_atomic_fetch_sub_i64(&counter->value, 1, PLATFORM_MEMORY_ORDER_ACQ_REL) != 1) {
+    // More jobs were added against the counter in the meantime. Everything waiting keeps waiting
+    counter->waiting = waiting;
+    waiting = 0;
+  }
+
+  // Fibers are only moved to the ready list. Jobs are queued once the lock is released,
+  // since a job that cannot be queued runs on the spot
+  while (waiting) {
+    job_deferred* next = waiting->next;
+    if (waiting->fiber) {
+      job_fiber_ready_locked(waiting->fiber);
+      waiting->fiber = 0;
+      waiting->next = state.free_deferred;
+      state.free_deferred = waiting;
+      resumed++;
+    } else {
+      waiting->next = jobs;
+      jobs = waiting;
+    }
+    waiting = next;
+  }
+  platform_mutex_unlock(&state.lock);
+
+  u32 queued = 0;
+  while (jobs) {
+    job item = jobs->job;
+    job_deferred* next = jobs->next;
+
+    platform_mutex_lock(&state.lock);
+    jobs->next = state.free_deferred;
+    state.free_deferred = jobs;
+    platform_mutex_unlock(&state.lock);
+
+    queued += job_submit(&item);
+    jobs = next;
+  }
+
+  if (queued + resumed) {
+    job_wake_workers(queued + resumed);
+  }
+}
+
+static void
+job_counter_decrement(job_counter* counter) {
+  i64 value = platform_atomic_load_i64(&counter->value, PLATFORM_MEMORY_ORDER_RELAXED);
+  while (value != 1) {
+    // Release so whoever sees the counter reach 0 also sees what the job wrote
+    if (platform_atomic_compare_exchange_i64(&counter->value, &value, value - 1, PLATFORM_MEMORY_ORDER_ACQ_REL)) {
+      return;
+    }
+  }
+  job_counter_finish(counter);
+}
+
+static void
+job_execute(job* item) {
+  b8 zone = item->desc.name ? profiler_zone_begin(item->desc.name) : FALSE;
+
+  // Tell the fiber which zone to close if the job parks
+  job_thread* thread = job_current_thread();
+  job_fiber* fiber = thread ? thread->running : 0;
+  const char* outer_zone = 0;
+  if (fiber) {
+    outer_zone = fiber->zone;
+    fiber->zone = zone ? item->desc.name : outer_zone;
+  }
+
+  item->desc.entry(item->desc.params);
+
+  if (zone) {
+    profiler_zone_end();
+  }
+  if (fiber) {
+    fiber->zone = outer_zone;
+  }
+
+  if (item->counter) {
+    job_counter_decrement(item->counter);
+  }
+}
+
+// Park an idle worker until there is work
+static void
+job_worker_sleep() {
+  platform_atomic_fetch_add_u32(&state.sleeping, 1, PLATFORM_MEMORY_ORDER_SEQ_CST);
+  platform_atomic_thread_fence(PLATFORM_MEMORY_ORDER_SEQ_CST);
+
+  // Shutting down counts as work, so the worker gets back to its loop and exits
+  b8 stay_awake = !platform_atomic_load_b8(&state.running, PLATFORM_MEMORY_ORDER_ACQUIRE) ||
+    platform_atomic_load_u32(&state.ready_count, PLATFORM_MEMORY_ORDER_ACQUIRE) > 0;
+  for (u32 i = 0; i < state.thread_count && !stay_awake; ++i) {
+    stay_awake = !job_queue_empty(state.threads[i].queue);
+  }
+
+  if (!stay_awake) {
+    platform_semaphore_wait(&state.wake, PLATFORM_WAIT_INFINITE);
+    return;
+  }
+
+  // Work arrived while going to sleep. Take the count back. If a submitter already
+  // took it and signalled, the extra signal only costs some worker one spurious wake
+  u32 sleeping = platform_atomic_load_u32(&state.sleeping, PLATFORM_MEMORY_ORDER_RELAXED);
+  while (sleeping > 0) {
+    if (platform_atomic_compare_exchange_u32(&state.sleeping, &sleeping, sleeping - 1, PLATFORM_MEMORY_ORDER_SEQ_CST)) {
+      return;
+    }
+  }
+}
+
+/*
+  Scheduling loop run by every pool fiber: resume ready fibers, and run
+  jobs until the thread's own context can continue (its counter in
+  job_wait is done, or the worker is shutting down)
+*/
+static void
+job_fiber_schedule(job_fiber* self) {
+  u32 idle = 0;
+  job item;
+  for (;;) {
+    job_thread* thread = job_current_thread();
+    b8 return_home = thread->home_wait ?
+      job_counter_done(thread->home_wait) :
+      !platform_atomic_load_b8(&state.running, PLATFORM_MEMORY_ORDER_ACQUIRE);
+    if (return_home) {
+      job_fiber_switch(self, &thread->context, 0);
+      idle = 0;
+      continue;
+    }
+
+    job_fiber* ready = job_fiber_take_ready();
+    if (ready) {
+      job_fiber_switch(self, &ready->fiber, 0);
+      idle = 0;
+      continue;
+    }
+
+    if (job_find(thread, &item)) {
+      job_execute(&item);
+      idle = 0;
+    } else if (thread->worker) {
+      if (++idle < JOB_IDLE_SPINS) {
+        platform_cpu_pause();
+      } else {
+        idle = 0;
+        job_worker_sleep();
+      }
+    } else if (++idle < JOB_WAIT_SPINS) {
+      platform_cpu_pause();
+    } else {
+      // Whatever the thread waits on is running on other threads
+      idle = 0;
+      platform_thread_yield();
+    }
+  }
+}
+
+static void
+job_fiber_main(void* params) {
+  job_fiber* self = (job_fiber*)params;
+  job_switched_in(self);
+  job_fiber_schedule(self);
+}
+
+/*
+  Run the pool fiber next until counter reaches 0. From a fiber, the
+  fiber parks on the counter and next takes over the thread. From a
+  thread's own context, the context waits while next runs jobs
+*/
+static void
+job_wait_on_fiber(job_thread* thread, job_fiber* next, job_counter* counter) {
+  job_fiber* self = thread->running;
+  if (self) {
+    // A zone cannot stay open on a thread the fiber may not come back to
+    const char* zone = self->zone;
+    if (zone) {
+      profiler_zone_end();
+    }
+    job_fiber_switch(self, &next->fiber, counter);
+    if (zone) {
+      profiler_zone_begin(zone);
+    }
+    return;
+  }
+
+  thread->home_wait = counter;
+  thread->previous = 0;
+  thread->park_counter = 0;
+  platform_fiber_switch(&thread->context, &next->fiber);
+  // The thread's own context only ever resumes on its own thread
+  job_switched_in(0);
+  thread->home_wait = 0;
+}
+
+// Run jobs on the calling thread's stack until the counter reaches 0
+static void
+job_wait_help(job_counter* counter) {
+  u32 spins = 0;
+  job item;
+  while (!job_counter_done(counter)) {
+    if (job_find(job_current_thread(), &item)) {
+      job_execute(&item);
+      spins = 0;
+    } else if (++spins < JOB_WAIT_SPINS) {
+      platform_cpu_pause();
+    } else {
+      // Whatever is left is running on other threads
+      spins = 0;
+      platform_thread_yield();
+    }
+  }
+}
+
+static u32
+job_worker_main(void* params) {
+  job_thread* thread = (job_thread*)params;
+  current_thread = thread;
+  platform_thread_set_name(thread->name);
+  if (thread->affinity && !platform_thread_set_affinity(thread->affinity)) {
+    P_WARN("Unable to pin %s to its core", thread->name);
+  }
+  profiler_name_thread(thread->name);
+
+  if (thread->first_fiber && platform_fiber_from_thread(&thread->context)) {
+    // Hand the thread over to the pool. It only comes back at shutdown
+    platform_fiber_switch(&thread->context, &thread->first_fiber->fiber);
+    job_switched_in(0);
+    platform_fiber_to_thread(&thread->context);
+    return 0;
+  }
+  if (thread->first_fiber) {
+    job_fiber_release(thread->first_fiber);
+  }
+
+  u32 idle = 0;
+  job item;
+  while (platform_atomic_load_b8(&state.running, PLATFORM_MEMORY_ORDER_ACQUIRE)) {
+    if (job_find(thread, &item)) {
+      job_execute(&item);
+      idle = 0;
+    } else if (++idle < JOB_IDLE_SPINS) {
+      platform_cpu_pause();
+    } else {
+      idle = 0;
+      job_worker_sleep();
+    }
+  }
+
+  return 0;
+}
+
+// Create the pool of fibers. Without enough of them, jobs run on thread stacks and job_wait blocks its thread
+static void
+job_fibers_initialize(job_system_config* config) {
+  u32 fiber_count = config && config->fiber_count ? config->fiber_count : JOB_DEFAULT_FIBER_COUNT;
+  u32 stack_size = config && config->fiber_stack_size ? config->fiber_stack_size : JOB_DEFAULT_FIBER_STACK_SIZE;
+  // Every thread needs one to run its loop, and more to take over when jobs park
+  u32 minimum = state.thread_count * 2;
+  if (fiber_count < minimum) {
+    fiber_count = minimum;
+  }
+
+  state.fiber_capacity = fiber_count;
+  state.fibers = pallocate(sizeof(job_fiber) * fiber_count, MEMORY_TAG_JOB);
+  for (u32 i = 0; i < fiber_count; ++i) {
+    job_fiber* fiber = &state.fibers[i];
+    if (!platform_fiber_create(stack_size, job_fiber_main, fiber, &fiber->fiber)) {
+      break;
+    }
+    fiber->next = state.free_fibers;
+    state.free_fibers = fiber;
+    state.fiber_count++;
+  }
+
+  state.fibers_enabled = state.fiber_count >= minimum && platform_fiber_from_thread(&state.threads[0].context);
+  if (!state.fibers_enabled) {
+    P_WARN("Only %u of %u job fibers could be created. Jobs will block their thread while waiting", state.fiber_count, fiber_count);
+  }
+}
+
+static void
+job_fibers_shutdown() {
+  // Fibers still parked belong to jobs that never finished, and are dropped with them
+  for (u32 i = 0; i < state.fiber_count; ++i) {
+    platform_fiber_destroy(&state.fibers[i].fiber);
+  }
+  if (state.fibers) {
+    pfree(state.fibers, sizeof(job_fiber) * state.fiber_capacity, MEMORY_TAG_JOB);
+  }
+  if (state.fibers_enabled) {
+    platform_fiber_to_thread(&state.threads[0].context);
+  }
+  state.fibers = 0;
+  state.fiber_capacity = 0;
+  state.fiber_count = 0;
+  state.fibers_enabled = FALSE;
+}
+
+static void
+job_log_topology() {
+  platform_cpu_topology* topology = &state.topology;
+  P_INFO("CPU: %u logical processors on %u physical cores, %u NUMA node%s",
+    topology->logical_processor_count,
+    topology->physical_core_count,
+    topology->numa_node_count,
+    topology->numa_node_count == 1 ? "" : "s");
+  P_INFO("CPU caches: L1d %uK, L1i %uK, L2 %uK, L3 %uK, %u byte lines",
+    topology->l1_data_cache_size / 1024,
+    topology->l1_instruction_cache_size / 1024,
+    topology->l2_cache_size / 1024,
+    topology->l3_cache_size / 1024,
+    topology->cache_line_size);
+}
+
+// Decide how many workers to start and where each thread runs
+static u32
+job_place_threads(job_system_config* config) {
+  u32 worker_count = config ? config->worker_count : 0;
+  u32 reserved = config ? config->reserved_cores : 0;
+  state.topology_known = platform_get_cpu_topology(&state.topology);
+  // Without a topology every logical processor counts as a core
+  u32 cores = state.topology_known ? state.topology.physical_core_count : platform_get_processor_count();
+  if (state.topology_known) {
+    job_log_topology();
+  }
+
+  if (worker_count == 0) {
+    // The main thread works too, so it takes one core
+    u32 taken = 1 + reserved;
+    worker_count = cores > taken ? cores - taken : 1;
+  }
+  if (worker_count > JOB_MAX_WORKERS) {
+    worker_count = JOB_MAX_WORKERS;
+  }
+
+  // Pinning only helps while every thread has a core to itself. Past that the
+  // scheduler does better moving threads around than two fixed to one core
+  state.reserved_cores = reserved;
+  state.pinning = state.topology_known && !(config && config->disable_pinning) &&
+    1 + reserved + worker_count <= state.topology.physical_core_count;
+  if (!state.pinning && state.topology_known && !(config && config->disable_pinning)) {
+    P_INFO("Job threads are not pinned: %u threads and %u reserved cores need more than %u physical cores",
+      worker_count + 1, reserved, state.topology.physical_core_count);
+  }
+  return worker_count;
+}
+
+b8
+job_system_initialize(job_system_config* config) {
+  pzero_memory(&state, sizeof(state));
+
+  u32 worker_count = job_place_threads(config);
+
+  if (!platform_semaphore_create(0, &state.wake)) {
+    P_ERROR("Unable to create the job system semaphore");
+    return FALSE;
+  }
+  if (!platform_mutex_create(&state.lock)) {
+    P_ERROR("Unable to create the job system lock");
+    platform_semaphore_destroy(&state.wake);
+    return FALSE;
+  }
+
+  for (u32 i = 0; i < JOB_MAX_DEFERRED; ++i) {
+    state.deferred[i].next = state.free_deferred;
+    state.free_deferred = &state.deferred[i];
+  }
+
+  state.thread_count = worker_count + 1;
+  for (u32 i = 0; i < state.thread_count; ++i) {
+    job_thread* thread = &state.threads[i];
+    thread->queue = pallocate(sizeof(job_queue), MEMORY_TAG_JOB);
+    thread->steal_seed = i + 1;
+    thread->worker = i > 0;
+    if (state.pinning) {
+      // Reserved cores sit between the main thread's and the workers'
+      thread->affinity = state.topology.core_masks[thread->worker ? state.reserved_cores + i : 0];
+    }
+    if (thread->worker) {
+      snprintf(thread->name, sizeof(thread->name), "job worker %u", i);
+    } else {
+      snprintf(thread->name, sizeof(thread->name), "main");
+    }
+  }
+
+  // The calling thread is the main thread
+  current_thread = &state.threads[0];
+  job_fibers_initialize(config);
+  state.running = TRUE;
+  state.initialized = TRUE;
+
+  for (u32 i = 1; i < state.thread_count; ++i) {
+    job_thread* thread = &state.threads[i];
+    thread->first_fiber = state.fibers_enabled ? job_fiber_acquire() : 0;
+    if (!platform_thread_create(job_worker_main, thread, &thread->thread)) {
+      P_ERROR("Unable to start %s", thread->name);
+      if (thread->first_fiber) {
+        job_fiber_release(thread->first_fiber);
+      }
+      break;
+    }
+    state.worker_count++;
+  }
+
+  // Pinned only now, since threads started from here inherit its affinity
+  if (state.threads[0].affinity && !platform_thread_set_affinity(state.threads[0].affinity)) {
+    P_WARN("Unable to pin the main thread to its core");
+  }
+
+  P_INFO("Job system started with %u workers and %u fibers", state.worker_count, state.fibers_enabled ? state.fiber_count : 0);
+  return TRUE;
+}
+
+void
+job_system_shutdown() {
+  if (!state.initialized) {
+    return;
+  }
+
+  platform_atomic_store_b8(&state.running, FALSE, PLATFORM_MEMORY_ORDER_RELEASE);
+  for (u32 i = 0; i < state.worker_count; ++i) {
+    platform_semaphore_signal(&state.wake);
+  }
+  for (u32 i = 0; i < state.worker_count; ++i) {
+    platform_thread_join(&state.threads[i + 1].thread);
+  }
+
+  job_fibers_shutdown();
+  for (u32 i = 0; i < state.thread_count; ++i) {
+    pfree(state.threads[i].queue, sizeof(job_queue), MEMORY_TAG_JOB);
+    state.threads[i].queue = 0;
+  }
+  state.thread_count = 0;
+  state.worker_count = 0;
+  current_thread = 0;
+
+  platform_mutex_destroy(&state.lock);
+  platform_semaphore_destroy(&state.wake);
+  state.initialized = FALSE;
+}
+
+u32
+job_system_worker_count() {
+  return state.worker_count;
+}
+
+u64
+job_system_reserved_core_mask(u32 index) {
+  if (!state.pinning || index >= state.reserved_cores) {
+    return 0;
+  }
+  return state.topology.core_masks[1 + index];
+}
+
+void
+job_run(const job_desc* jobs, u32 count, job_counter* counter) {
+  if (counter) {
+    // Raised before any job can run, so it cannot reach 0 early
+    platform_atomic_fetch_add_i64(&counter->value, count, PLATFORM_MEMORY_ORDER_RELAXED);
+  }
+
+  u32 queued = 0;
+  for (u32 i = 0; i < count; ++i) {
+    job item = { jobs[i], counter };
+    queued += job_submit(&item);
+  }
+
+  if (queued) {
+    job_wake_workers(queued);
+  }
+}
+
+void
+job_run_after(job_counter* dependency, const job_desc* jobs, u32 count, job_counter* counter) {
+  if (counter) {
+    platform_atomic_fetch_add_i64(&counter->value, count, PLATFORM_MEMORY_ORDER_RELAXED);
+  }
+
+  u32 deferred = 0;
+  if (state.initialized) {
+    platform_mutex_lock(&state.lock);
+    // Checked under the lock, which job_counter_finish holds while the counter reaches 0
+    if (!job_counter_done(dependency)) {
+      while (deferred < count && state.free_deferred) {
+        job_deferred* node = state.free_deferred;
+        state.free_deferred = node->next;
+        node->job.desc = jobs[deferred];
+        node->job.counter = counter;
+        node->fiber = 0;
+        node->next = dependency->waiting;
+        dependency->waiting = node;
+        deferred++;
+      }
+    }
+    platform_mutex_unlock(&state.lock);
+  }
+
+  if (deferred == count) {
+    return;
+  }
+
+  if (!job_counter_done(dependency)) {
+    P_WARN("More than %u jobs waiting on dependencies. Waiting for the dependency instead", JOB_MAX_DEFERRED);
+    job_wait(dependency);
+  }
+
+  u32 queued = 0;
+  for (u32 i = deferred; i < count; ++i) {
+    job item = { jobs[i], counter };
+    queued += job_submit(&item);
+  }
+
+  if (queued) {
+    job_wake_workers(queued);
+  }
+}
+
+b8
+job_counter_done(job_counter* counter) {
+  return platform_atomic_load_i64(&counter->value, PLATFORM_MEMORY_ORDER_ACQUIRE) == 0;
+}
+
+void
+job_wait(job_counter* counter) {
+  while (!job_counter_done(counter)) {
+    job_thread* thread = job_current_thread();
+    // Threads that could not switch to fibers run jobs on their own stack
+    b8 can_switch = thread && state.fibers_enabled && (thread->running || thread->context.internal_data);
+    job_fiber* next = can_switch ? job_fiber_acquire() : 0;
+    if (!next) {
+      // Outside the job system, or every fiber is taken
+      job_wait_help(counter);
+      return;
+    }
+
+    job_wait_on_fiber(thread, next, counter);
+  }
+}
+
+typedef struct job_parallel_for_range {
+  PFN_job_range function;
+  void* params;
+  u32 count;
+  u32 chunk;
+  // Start of the next chunk to hand out
+  u64 next;
+} job_parallel_for_range;
+
+// Keep taking chunks until none are left
+static void
+job_parallel_for_entry(void* params) {
+  job_parallel_for_range* range = (job_parallel_for_range*)params;
+  for (;;) {
+    u64 start = platform_atomic_fetch_add_u64(&range->next, range->chunk, PLATFORM_MEMORY_ORDER_RELAXED);
+    if (start >= range->count) {
+      return;
+    }
+
+    u64 end = start + range->chunk;
+    range->function((u32)start, (u32)(end < range->count ? end : range->count), range->params);
+  }
+}
+
+void
+job_parallel_for(u32 count, u32 min_chunk, PFN_job_range function, void* params) {
+  if (count == 0) {
+    return;
+  }
+
+  u32 threads = state.worker_count + 1;
+  u64 target_chunks = (u64)threads * JOB_CHUNKS_PER_THREAD;
+  u32 chunk = (u32)((count + target_chunks - 1) / target_chunks);
+  if (chunk < min_chunk) {
+    chunk = min_chunk;
+  }
+  if (chunk == 0) {
+    chunk = 1;
+  }
+  u64 chunk_count = ((u64)count + chunk - 1) / chunk;
+
+  job_parallel_for_range range = { function, params, count, chunk, 0 };
+
+  // Chunks are taken as each thread gets to them, so one job per thread is enough.
+  // The calling thread runs one of them itself
+  u32 helpers = (u32)(chunk_count < threads ? chunk_count : threads) - 1;
+  job_counter counter = {0};
+  if (helpers > 0) {
+    job_desc helper_jobs[JOB_MAX_WORKERS];
+    for (u32 i = 0; i < helpers; ++i) {
+      helper_jobs[i].entry = job_parallel_for_entry;
+      helper_jobs[i].params = &range;
+      helper_jobs[i].name = "parallel for";
+    }
+    job_run(helper_jobs, helpers, &counter);
+  }
+
+  job_parallel_for_entry(&range);
+  job_wait(&counter);
+}
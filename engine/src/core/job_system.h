@@ -0,0 +1,136 @@
+/**
+ * Job system
+ *
+ * A fixed pool of worker threads, one per physical core with the main
+ * thread taking the first. SMT siblings share a core's FPUs and caches, so
+ * they do not get a worker of their own. Each thread is pinned to its core,
+ * and a few cores can be held back for threads outside the job system,
+ * such as the render thread. Every worker, and the main thread, owns a work-stealing
+ * deque (Chase-Lev): jobs are pushed and popped at the bottom by the owner,
+ * and idle threads steal from the top of the others.
+ *
+ * Completion is tracked with counters. Submitting jobs against a counter
+ * raises it by the number of jobs, and each job lowers it when it finishes.
+ * Jobs can also be held back until another counter reaches 0.
+ *
+ * Jobs run on a pool of fibers. A job that calls job_wait parks its fiber
+ * on the counter and its thread goes on with other jobs, so long chains of
+ * dependencies never block a core. The parked job resumes once the counter
+ * reaches 0, possibly on another thread: a job that waits must not rely on
+ * staying on one thread, and profile zones it opens must not span the wait.
+ * Outside a job, job_wait runs other jobs until the counter reaches 0.
+*/
+#pragma once
+
+#include "defines.h"
+
+// Most worker threads started, whatever the core count
+#define JOB_MAX_WORKERS 32
+
+// Jobs each thread's deque holds. Must be a power of 2. A thread submitting into a full deque runs the job itself
+#define JOB_QUEUE_CAPACITY 4096
+
+// Jobs and parked fibers that can be held back on counters at once. Past this
+// job_run_after waits for the dependency instead, and waiting fibers poll their counter
+#define JOB_MAX_DEFERRED 1024
+
+// Fibers in the pool when the config does not say. Bounds how many jobs can be parked at once
+#define JOB_DEFAULT_FIBER_COUNT 128
+
+// Stack of each fiber when the config does not say. Jobs run on these stacks
+#define JOB_DEFAULT_FIBER_STACK_SIZE (64 * 1024)
+
+typedef void (*PFN_job_entry)(void* params);
+
+// Runs the items [start, end) of a parallel for
+typedef void (*PFN_job_range)(u32 start, u32 end, void* params);
+
+struct job_deferred;
+
+/*
+  Tracks how many jobs submitted against it have not finished
+  Zero it before use. Reuse it only once it has reached 0
+*/
+typedef struct job_counter {
+  i64 value;
+  // Jobs waiting for this counter to reach 0
+  struct job_deferred* waiting;
+} job_counter;
+
+typedef struct job_desc {
+  PFN_job_entry entry;
+  void* params;
+  // Profile zone the job runs in. Must be a string literal. 0 for no zone
+  const char* name;
+} job_desc;
+
+typedef struct job_system_config {
+  // Worker threads to start. 0 starts one per physical core, less the main thread's and the reserved ones
+  u32 worker_count;
+  // Physical cores kept free of workers for other threads. See job_system_reserved_core_mask
+  u32 reserved_cores;
+  // Leave thread placement to the OS scheduler instead of pinning each thread to a core
+  b8 disable_pinning;
+  // Fibers to run jobs on. 0 uses JOB_DEFAULT_FIBER_COUNT. Raised to at least two per thread
+  u32 fiber_count;
+  // Stack size of each fiber in bytes. 0 uses JOB_DEFAULT_FIBER_STACK_SIZE
+  u32 fiber_stack_size;
+} job_system_config;
+
+/*
+  Start the workers. The calling thread becomes the main thread of the job system
+  @param config - worker count. 0 for the default
+*/
+b8 job_system_initialize(job_system_config* config);
+
+// Stop the workers. Jobs still queued are dropped
+void job_system_shutdown();
+
+// Worker threads running, not counting the main thread
+P_API u32 job_system_worker_count();
+
+/*
+  Affinity mask of a core held back with job_system_config.reserved_cores,
+  for a thread to pass to platform_thread_set_affinity
+  @param index - which reserved core, from 0
+  @returns 0 if there is no such core or threads are not being pinned
+*/
+P_API u64 job_system_reserved_core_mask(u32 index);
+
+/*
+  Queue jobs to run on any thread
+  Threads outside the job system have no deque, and run the jobs before returning
+  @param jobs - jobs to run. Copied, so the array may be reused right away
+  @param count - number of jobs
+  @param counter - raised by count now, and lowered as each job finishes. May be 0
+*/
+P_API void job_run(const job_desc* jobs, u32 count, job_counter* counter);
+
+/*
+  Queue jobs that may only start once a dependency reaches 0
+  @param dependency - counter to wait for
+  @param jobs - jobs to run. Copied, so the array may be reused right away
+  @param count - number of jobs
+  @param counter - raised by count now, and lowered as each job finishes. May be 0
+*/
+P_API void job_run_after(job_counter* dependency, const job_desc* jobs, u32 count, job_counter* counter);
+
+// TRUE once every job submitted against the counter has finished
+P_API b8 job_counter_done(job_counter* counter);
+
+/*
+  Return once the counter reaches 0. Inside a job, the job is set aside and
+  its thread runs other jobs meanwhile. Elsewhere, the calling thread runs
+  queued jobs until then
+*/
+P_API void job_wait(job_counter* counter);
+
+/*
+  Call function over [0, count) split into chunks, spread over every thread,
+  and return once all of it has run. The calling thread takes part
+  @param count - number of items
+  @param min_chunk - fewest items handed out at once. Raise it when items are cheap. 0 means 1
+  @param function - called with each chunk's range
+  @param params - passed to function
+*/
+P_API void job_parallel_for(u32 count, u32 min_chunk, PFN_job_range function, void* params);
@@ -0,0 +1,534 @@
+#include "log_deferred.h"
+
+#include "core/pmemory.h"
+#include "containers/darray.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// What kind of value a conversion consumes
+typedef enum log_arg_kind {
+  LOG_ARG_NONE,     // "%%", consumes nothing
+  LOG_ARG_SIGNED,
+  LOG_ARG_UNSIGNED,
+  LOG_ARG_CHAR,
+  LOG_ARG_FLOAT,
+  LOG_ARG_STRING,
+  LOG_ARG_POINTER,
+  LOG_ARG_COUNT     // "%n", consumes a pointer and prints nothing
+} log_arg_kind;
+
+typedef enum log_arg_length {
+  LOG_LENGTH_DEFAULT,
+  LOG_LENGTH_HH,
+  LOG_LENGTH_H,
+  LOG_LENGTH_L,
+  LOG_LENGTH_LL,
+  LOG_LENGTH_J,
+  LOG_LENGTH_Z,
+  LOG_LENGTH_T,
+  LOG_LENGTH_LONG_DOUBLE
+} log_arg_length;
+
+// One parsed conversion specification, e.g. "%-8.3lf"
+typedef struct log_spec {
+  log_arg_kind kind;
+  log_arg_length length;
+  char conversion;
+
+  // Flags and explicit digits, copied so the spec can be rebuilt for snprintf
+  char flags[8];
+  char width[16];
+  char precision[16];
+  b8 has_precision;
+  b8 star_width;
+  b8 star_precision;
+} log_spec;
+
+// Parse the conversion starting just after a '%'. Returns the character after the conversion
+static const char*
+log_parse_spec(const char* p, log_spec* spec) {
+  pzero_memory(spec, sizeof(log_spec));
+
+  u32 count = 0;
+  while (*p && strchr("-+ #0", *p) && count < sizeof(spec->flags) - 1) {
+    spec->flags[count++] = *p++;
+  }
+
+  count = 0;
+  if (*p == '*') {
+    spec->star_width = TRUE;
+    p++;
+  } else {
+    while (*p >= '0' && *p <= '9' && count < sizeof(spec->width) - 1) {
+      spec->width[count++] = *p++;
+    }
+  }
+
+  if (*p == '.') {
+    spec->has_precision = TRUE;
+    p++;
+    count = 0;
+    if (*p == '*') {
+      spec->star_precision = TRUE;
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9' && count < sizeof(spec->precision) - 1) {
+        spec->precision[count++] = *p++;
+      }
+    }
+  }
+
+  switch (*p) {
+    case 'h':
+      p++;
+      spec->length = LOG_LENGTH_H;
+      if (*p == 'h') {
+        p++;
+        spec->length = LOG_LENGTH_HH;
+      }
+      break;
+    case 'l':
+      p++;
+      spec->length = LOG_LENGTH_L;
+      if (*p == 'l') {
+        p++;
+        spec->length = LOG_LENGTH_LL;
+      }
+      break;
+    case 'j': p++; spec->length = LOG_LENGTH_J; break;
+    case 'z': p++; spec->length = LOG_LENGTH_Z; break;
+    case 't': p++; spec->length = LOG_LENGTH_T; break;
+    case 'L': p++; spec->length = LOG_LENGTH_LONG_DOUBLE; break;
+  }
+
+  spec->conversion = *p;
+  switch (*p) {
+    case 'd':
+    case 'i':
+      spec->kind = LOG_ARG_SIGNED;
+      break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+      spec->kind = LOG_ARG_UNSIGNED;
+      break;
+    case 'c':
+      spec->kind = LOG_ARG_CHAR;
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      spec->kind = LOG_ARG_FLOAT;
+      break;
+    case 's':
+      spec->kind = LOG_ARG_STRING;
+      break;
+    case 'p':
+      spec->kind = LOG_ARG_POINTER;
+      break;
+    case 'n':
+      spec->kind = LOG_ARG_COUNT;
+      break;
+    case 0:
+      // Format ended mid-specification. Don't step past the terminator
+      spec->kind = LOG_ARG_NONE;
+      return p;
+    default:
+      // "%%" and anything unrecognised consume no argument
+      spec->kind = LOG_ARG_NONE;
+      break;
+  }
+
+  return p + 1;
+}
+
+static i64
+log_read_signed(log_arg_length length, va_list* args) {
+  switch (length) {
+    case LOG_LENGTH_HH: return (signed char)va_arg(*args, int);
+    case LOG_LENGTH_H: return (short)va_arg(*args, int);
+    case LOG_LENGTH_L: return va_arg(*args, long);
+    case LOG_LENGTH_LL: return va_arg(*args, long long);
+    case LOG_LENGTH_J: return va_arg(*args, intmax_t);
+    case LOG_LENGTH_Z: return (i64)va_arg(*args, size_t);
+    case LOG_LENGTH_T: return va_arg(*args, ptrdiff_t);
+    default: return va_arg(*args, int);
+  }
+}
+
+static u64
+log_read_unsigned(log_arg_length length, va_list* args) {
+  switch (length) {
+    case LOG_LENGTH_HH: return (unsigned char)va_arg(*args, unsigned int);
+    case LOG_LENGTH_H: return (unsigned short)va_arg(*args, unsigned int);
+    case LOG_LENGTH_L: return va_arg(*args, unsigned long);
+    case LOG_LENGTH_LL: return va_arg(*args, unsigned long long);
+    case LOG_LENGTH_J: return va_arg(*args, uintmax_t);
+    case LOG_LENGTH_Z: return va_arg(*args, size_t);
+    case LOG_LENGTH_T: return (u64)va_arg(*args, ptrdiff_t);
+    default: return va_arg(*args, unsigned int);
+  }
+}
+
+u32
+log_deferred_capture(char* buffer, u32 capacity, const char* format, va_list args) {
+  va_list arg_ptr;
+  va_copy(arg_ptr, args);
+
+  u32 offset = 0;
+  const char* p = format;
+  while (*p) {
+    if (*p++ != '%') {
+      continue;
+    }
+
+    log_spec spec;
+    p = log_parse_spec(p, &spec);
+    if (spec.kind == LOG_ARG_NONE) {
+      continue;
+    }
+
+    // A precision bounds how much of a string is read, so the string need not be terminated.
+    // Negative means none, as it does for a '*' precision
+    i64 precision = spec.has_precision && !spec.star_precision ? atoi(spec.precision) : -1;
+
+    // Widths and precisions given as '*' come before the value itself
+    i32 stars = spec.star_width + spec.star_precision;
+    for (i32 i = 0; i < stars; ++i) {
+      i64 star_value = va_arg(arg_ptr, int);
+      if (spec.star_precision && i == stars - 1) {
+        precision = star_value;
+      }
+      if (offset + sizeof(i64) > capacity) {
+        va_end(arg_ptr);
+        return offset;
+      }
+      pcopy_memory(buffer + offset, &star_value, sizeof(i64));
+      offset += sizeof(i64);
+    }
+
+    u64 value = 0;
+    switch (spec.kind) {
+      case LOG_ARG_SIGNED: {
+        i64 signed_value = log_read_signed(spec.length, &arg_ptr);
+        pcopy_memory(&value, &signed_value, sizeof(u64));
+      } break;
+      case LOG_ARG_UNSIGNED:
+        value = log_read_unsigned(spec.length, &arg_ptr);
+        break;
+      case LOG_ARG_CHAR:
+        value = (u64)va_arg(arg_ptr, int);
+        break;
+      case LOG_ARG_FLOAT: {
+        f64 float_value = spec.length == LOG_LENGTH_LONG_DOUBLE ? (f64)va_arg(arg_ptr, long double) : va_arg(arg_ptr, double);
+        pcopy_memory(&value, &float_value, sizeof(u64));
+      } break;
+      case LOG_ARG_POINTER:
+        value = (u64)(uintptr_t)va_arg(arg_ptr, void*);
+        break;
+      case LOG_ARG_COUNT:
+        // Nothing sensible to write back to later. Consume and ignore
+        va_arg(arg_ptr, void*);
+        continue;
+      case LOG_ARG_STRING: {
+        const char* string = va_arg(arg_ptr, const char*);
+        if (!string) {
+          string = "(null)";
+        }
+        if (offset + sizeof(u16) > capacity) {
+          va_end(arg_ptr);
+          return offset;
+        }
+
+        u64 length = precision >= 0 ? strnlen(string, (size_t)precision) : strlen(string);
+        u64 available = capacity - offset - sizeof(u16);
+        if (length > available) {
+          length = available;
+        }
+        if (length > 0xFFFF) {
+          length = 0xFFFF;
+        }
+
+        u16 stored_length = (u16)length;
+        pcopy_memory(buffer + offset, &stored_length, sizeof(u16));
+        pcopy_memory(buffer + offset + sizeof(u16), string, length);
+        offset += sizeof(u16) + stored_length;
+      } continue;
+      default:
+        continue;
+    }
+
+    if (offset + sizeof(u64) > capacity) {
+      break;
+    }
+    pcopy_memory(buffer + offset, &value, sizeof(u64));
+    offset += sizeof(u64);
+  }
+
+  va_end(arg_ptr);
+  return offset;
+}
+
+// Rebuild a spec as a snprintf format. Star values are substituted and
+// integer lengths are widened to ll to match the captured 64-bit values
+static void
+log_build_spec(char* out, u64 size, const log_spec* spec, i64 width, i64 precision) {
+  char width_text[24] = "";
+  char precision_text[24] = "";
+
+  if (spec->star_width) {
+    snprintf(width_text, sizeof(width_text), "%lld", (long long)width);
+  } else {
+    snprintf(width_text, sizeof(width_text), "%s", spec->width);
+  }
+
+  if (spec->has_precision) {
+    if (spec->star_precision) {
+      snprintf(precision_text, sizeof(precision_text), ".%lld", (long long)precision);
+    } else {
+      snprintf(precision_text, sizeof(precision_text), ".%s", spec->precision);
+    }
+  }
+
+  b8 is_integer = spec->kind == LOG_ARG_SIGNED || spec->kind == LOG_ARG_UNSIGNED;
+  snprintf(out, size, "%%%s%s%s%s%c", spec->flags, width_text, precision_text, is_integer ? "ll" : "", spec->conversion);
+}
+
+u32
+log_deferred_format(char* out, u32 capacity, const char* format, const char* args, u32 args_length) {
+  if (capacity == 0) {
+    return 0;
+  }
+
+  u32 written = 0;
+  u32 offset = 0;
+  const char* p = format;
+
+  // Leave one byte for the terminator
+  while (*p && written < capacity - 1) {
+    if (*p != '%') {
+      out[written++] = *p++;
+      continue;
+    }
+
+    p++;
+    log_spec spec;
+    p = log_parse_spec(p, &spec);
+    if (spec.kind == LOG_ARG_NONE) {
+      if (spec.conversion == '%') {
+        out[written++] = '%';
+      }
+      continue;
+    }
+
+    i64 star_values[2] = {0, 0};
+    i32 stars = spec.star_width + spec.star_precision;
+    for (i32 i = 0; i < stars && offset + sizeof(i64) <= args_length; ++i) {
+      pcopy_memory(&star_values[i], args + offset, sizeof(i64));
+      offset += sizeof(i64);
+    }
+    i64 width = star_values[0];
+    i64 precision = 0;
+    if (spec.star_precision) {
+      precision = spec.star_width ? star_values[1] : star_values[0];
+    } else if (spec.has_precision) {
+      precision = strtoll(spec.precision, 0, 10);
+    }
+
+    if (spec.kind == LOG_ARG_COUNT) {
+      continue;
+    }
+
+    char spec_text[64];
+    log_build_spec(spec_text, sizeof(spec_text), &spec, width, precision);
+
+    i32 result = 0;
+    u32 remaining = capacity - written;
+    if (spec.kind == LOG_ARG_STRING) {
+      if (offset + sizeof(u16) > args_length) {
+        // The capture ran out of room
+        result = snprintf(out + written, remaining, "<?>");
+      } else {
+        u16 length = 0;
+        pcopy_memory(&length, args + offset, sizeof(u16));
+        offset += sizeof(u16);
+
+        // The stored bytes are not terminated, so bound them with a precision
+        char string_spec[80];
+        i32 max_length = length;
+        if (spec.has_precision && precision >= 0 && precision < max_length) {
+          max_length = (i32)precision;
+        }
+        snprintf(string_spec, sizeof(string_spec), "%%%s%s.*s", spec.flags, spec.star_width ? "*" : spec.width);
+        if (spec.star_width) {
+          result = snprintf(out + written, remaining, string_spec, (int)width, max_length, args + offset);
+        } else {
+          result = snprintf(out + written, remaining, string_spec, max_length, args + offset);
+        }
+        offset += length;
+      }
+    } else if (offset + sizeof(u64) > args_length) {
+      result = snprintf(out + written, remaining, "<?>");
+    } else {
+      u64 value = 0;
+      pcopy_memory(&value, args + offset, sizeof(u64));
+      offset += sizeof(u64);
+
+      switch (spec.kind) {
+        case LOG_ARG_SIGNED: {
+          i64 signed_value;
+          pcopy_memory(&signed_value, &value, sizeof(i64));
+          result = snprintf(out + written, remaining, spec_text, (long long)signed_value);
+        } break;
+        case LOG_ARG_UNSIGNED:
+          result = snprintf(out + written, remaining, spec_text, (unsigned long long)value);
+          break;
+        case LOG_ARG_CHAR:
+          result = snprintf(out + written, remaining, spec_text, (int)value);
+          break;
+        case LOG_ARG_FLOAT: {
+          f64 float_value;
+          pcopy_memory(&float_value, &value, sizeof(f64));
+          result = snprintf(out + written, remaining, spec_text, float_value);
+        } break;
+        case LOG_ARG_POINTER:
+          result = snprintf(out + written, remaining, spec_text, (void*)(uintptr_t)value);
+          break;
+        default:
+          break;
+      }
+    }
+
+    if (result > 0) {
+      written += (u32)result < remaining ? (u32)result : remaining - 1;
+    }
+  }
+
+  out[written] = 0;
+  return written;
+}
+
+// Format strings seen so far while decoding a file
+typedef struct log_decode_format {
+  u64 id;
+  char* string;
+} log_decode_format;
+
+b8
+log_binary_decode_file(const char* input_path, const char* output_path) {
+  static const char* level_strings[6] = {"[FATAL]", "[ERROR]", "[WARN]", "[INFO]", "[DEBUG]", "[TRACE]"};
+
+  FILE* input = fopen(input_path, "rb");
+  if (!input) {
+    P_ERROR("log_binary_decode_file: unable to open '%s'", input_path);
+    return FALSE;
+  }
+
+  u32 header[2];
+  if (fread(header, sizeof(header), 1, input) != 1 || header[0] != LOG_BINARY_MAGIC) {
+    P_ERROR("log_binary_decode_file: '%s' is not a binary log", input_path);
+    fclose(input);
+    return FALSE;
+  }
+  if (header[1] != LOG_BINARY_VERSION) {
+    P_ERROR("log_binary_decode_file: '%s' has version %u, expected %u", input_path, header[1], LOG_BINARY_VERSION);
+    fclose(input);
+    return FALSE;
+  }
+
+  FILE* output = stdout;
+  if (output_path) {
+    output = fopen(output_path, "w");
+    if (!output) {
+      P_ERROR("log_binary_decode_file: unable to create '%s'", output_path);
+      fclose(input);
+      return FALSE;
+    }
+  }
+
+  log_decode_format* formats = darray_create(log_decode_format);
+  char args[0xFFFF];
+  char text[0xFFFF];
+  b8 success = TRUE;
+
+  u8 record_type;
+  while (fread(&record_type, sizeof(u8), 1, input) == 1) {
+    if (record_type == LOG_BINARY_RECORD_FORMAT) {
+      log_decode_format format;
+      u16 length;
+      if (fread(&format.id, sizeof(u64), 1, input) != 1 || fread(&length, sizeof(u16), 1, input) != 1) {
+        success = FALSE;
+        break;
+      }
+
+      format.string = pallocate(length + 1, MEMORY_TAG_STRING);
+      if (fread(format.string, 1, length, input) != length) {
+        pfree(format.string, length + 1, MEMORY_TAG_STRING);
+        success = FALSE;
+        break;
+      }
+      darray_push(formats, format);
+    } else if (record_type == LOG_BINARY_RECORD_ENTRY) {
+      u64 id;
+      f64 timestamp;
+      u8 level;
+      u16 args_length;
+      if (fread(&id, sizeof(u64), 1, input) != 1 ||
+          fread(&timestamp, sizeof(f64), 1, input) != 1 ||
+          fread(&level, sizeof(u8), 1, input) != 1 ||
+          fread(&args_length, sizeof(u16), 1, input) != 1 ||
+          fread(args, 1, args_length, input) != args_length) {
+        success = FALSE;
+        break;
+      }
+
+      // The most recently defined formats are the most likely to be hit
+      const char* format = 0;
+      u64 format_count = darray_length(formats);
+      for (u64 i = format_count; i > 0; --i) {
+        if (formats[i - 1].id == id) {
+          format = formats[i - 1].string;
+          break;
+        }
+      }
+
+      if (!format) {
+        fprintf(output, "[%.6f]<unknown format %llx>\n", timestamp, id);
+        continue;
+      }
+
+      log_deferred_format(text, sizeof(text), format, args, args_length);
+      fprintf(output, "[%.6f]%s%s\n", timestamp, level_strings[level < 6 ? level : LOG_LEVEL_TRACE], text);
+    } else {
+      success = FALSE;
+      break;
+    }
+  }
+
+  if (!success) {
+    P_WARN("log_binary_decode_file: '%s' ends with a truncated or corrupt record", input_path);
+  }
+
+  u64 format_count = darray_length(formats);
+  for (u64 i = 0; i < format_count; ++i) {
+    pfree(formats[i].string, strlen(formats[i].string) + 1, MEMORY_TAG_STRING);
+  }
+  darray_destroy(formats);
+
+  fclose(input);
+  if (output != stdout) {
+    fclose(output);
+  }
+
+  return success;
+}
@@ -0,0 +1,65 @@
+/**
+ * Deferred-format logging
+ *
+ * Instead of formatting on the calling thread, a deferred log call stores
+ * the address of its (static) format string and the raw bytes of its
+ * arguments. The log writer thread, or the offline decoder, turns the pair
+ * back into text later.
+ *
+ * Argument encoding, in the order the format string consumes them:
+ *  - integers, characters, '*' widths : 8 bytes (widened to 64 bits)
+ *  - floating point                   : 8 bytes (f64)
+ *  - pointers                         : 8 bytes
+ *  - strings                          : u16 length followed by the bytes, no terminator
+*/
+#pragma once
+
+#include "defines.h"
+#include "core/logger.h"
+
+#include <stdarg.h>
+
+/**
+ * Binary log file layout
+ * header: u32 magic, u32 version
+ * then a stream of records, each starting with a u8 log_binary_record_type
+ *  - FORMAT: u64 format_id, u16 length, format string bytes
+ *  - ENTRY : u64 format_id, f64 timestamp, u8 level, u16 args_length, argument bytes
+*/
+#define LOG_BINARY_MAGIC 0x474F4C50 // "PLOG"
+#define LOG_BINARY_VERSION 1
+
+typedef enum log_binary_record_type {
+  LOG_BINARY_RECORD_FORMAT = 1,
+  LOG_BINARY_RECORD_ENTRY = 2
+} log_binary_record_type;
+
+/*
+  Capture the arguments described by format into buffer
+  @param buffer - destination for the encoded arguments
+  @param capacity - size of buffer in bytes. Strings are truncated to fit
+  @param format - printf-style format string
+  @param args - the arguments matching format
+  @returns number of bytes written to buffer
+*/
+u32 log_deferred_capture(char* buffer, u32 capacity, const char* format, va_list args);
+
+/*
+  Format previously captured arguments as text
+  @param out - destination string, always terminated
+  @param capacity - size of out in bytes
+  @param format - the format string the arguments were captured with
+  @param args - encoded arguments from log_deferred_capture
+  @param args_length - size of args in bytes
+  @returns number of characters written, not counting the terminator
+*/
+u32 log_deferred_format(char* out, u32 capacity, const char* format, const char* args, u32 args_length);
+
+/*
+  Convert a binary log file into text
+  @param input_path - binary log written by the logger
+  @param output_path - text file to write. NULL writes to the console
+  @returns TRUE on success, FALSE if the input could not be read or ends with a
+    truncated or corrupt record. Records before a bad one are still written
+*/
+P_API b8 log_binary_decode_file(const char* input_path, const char* output_path);
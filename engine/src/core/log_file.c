@@ -0,0 +1,215 @@
+#include "log_file.h"
+
+#include "core/logger.h"
+#include "core/pmemory.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Size of each mapped window. A multiple of every platform's map granularity
+#define LOG_FILE_WINDOW_SIZE (1024 * 1024)
+
+#define LOG_FILE_DEFAULT_MAX_SIZE (64 * 1024 * 1024)
+
+static b8 log_file_start(log_file* file);
+static void log_file_finish(log_file* file);
+static void log_file_rotate_names(log_file* file);
+static b8 log_file_next_window(log_file* file);
+
+b8
+log_file_open(log_file* out_file, const char* path, u64 max_size, u32 max_files, const void* header, u32 header_size) {
+  pzero_memory(out_file, sizeof(log_file));
+
+  if (strlen(path) + 8 > sizeof(out_file->path) || header_size > LOG_FILE_MAX_HEADER_SIZE) {
+    return FALSE;
+  }
+
+  snprintf(out_file->path, sizeof(out_file->path), "%s", path);
+  out_file->max_size = max_size ? max_size : LOG_FILE_DEFAULT_MAX_SIZE;
+  out_file->max_files = max_files;
+  if (header_size) {
+    pcopy_memory(out_file->header, header, header_size);
+    out_file->header_size = header_size;
+  }
+
+  // Keep the previous run's log around as the first rotated file
+  log_file_rotate_names(out_file);
+  return log_file_start(out_file);
+}
+
+void
+log_file_close(log_file* file) {
+  if (!file->file.internal_data) {
+    return;
+  }
+
+  log_file_finish(file);
+}
+
+b8
+log_file_prepare(log_file* file, u64 size) {
+  u64 length = file->window_offset + file->window_used;
+  if (length + size <= file->max_size || length <= file->header_size) {
+    return FALSE;
+  }
+
+  log_file_finish(file);
+  log_file_rotate_names(file);
+  if (!log_file_start(file)) {
+    return FALSE;
+  }
+
+  file->generation++;
+  return TRUE;
+}
+
+b8
+log_file_append(log_file* file, const void* data, u64 size) {
+  if (!file->file.internal_data) {
+    return FALSE;
+  }
+
+  const u8* bytes = (const u8*)data;
+  while (size > 0) {
+    if (file->window_used == file->window_size) {
+      if (!log_file_next_window(file)) {
+        return FALSE;
+      }
+    }
+
+    u64 chunk = file->window_size - file->window_used;
+    if (chunk > size) {
+      chunk = size;
+    }
+
+    pcopy_memory(file->window + file->window_used, bytes, chunk);
+    file->window_used += chunk;
+    bytes += chunk;
+    size -= chunk;
+  }
+
+  return TRUE;
+}
+
+void
+log_file_flush(log_file* file) {
+  if (!file->file.internal_data) {
+    return;
+  }
+
+  if (file->mapped) {
+    platform_file_flush_mapped(file->window, file->window_used);
+  } else {
+    platform_file_append(&file->file, file->window, file->window_used);
+    file->window_offset += file->window_used;
+    file->window_used = 0;
+  }
+}
+
+// Create an empty file at path and write the header
+static b8
+log_file_start(log_file* file) {
+  if (!platform_file_open(file->path, TRUE, &file->file)) {
+    return FALSE;
+  }
+
+  file->window_offset = 0;
+  file->window_used = 0;
+  file->window_size = LOG_FILE_WINDOW_SIZE;
+
+  // Map the first window. Fall back to buffered writes if mapping is unavailable
+  file->mapped = FALSE;
+  file->window = 0;
+  if (platform_file_resize(&file->file, file->window_size)) {
+    file->window = platform_file_map(&file->file, 0, file->window_size);
+  }
+
+  if (file->window) {
+    file->mapped = TRUE;
+  } else {
+    platform_file_resize(&file->file, 0);
+    file->window = platform_allocate(file->window_size, FALSE);
+  }
+
+  return log_file_append(file, file->header, file->header_size);
+}
+
+// Release the window and trim the file to the bytes written
+static void
+log_file_finish(log_file* file) {
+  u64 length = file->window_offset + file->window_used;
+
+  if (file->mapped) {
+    platform_file_flush_mapped(file->window, file->window_used);
+    platform_file_unmap(file->window, file->window_size);
+    platform_file_resize(&file->file, length);
+  } else {
+    platform_file_append(&file->file, file->window, file->window_used);
+    platform_free(file->window, FALSE);
+  }
+
+  file->window = 0;
+  file->window_used = 0;
+  file->window_offset = length;
+  platform_file_close(&file->file);
+}
+
+// Shift path.N-1 -> path.N ... path -> path.1, dropping the oldest
+static void
+log_file_rotate_names(log_file* file) {
+  char from[sizeof(file->path) + 8];
+  char to[sizeof(file->path) + 8];
+
+  if (file->max_files == 0) {
+    // Nothing is kept. The active file is truncated when it is reopened
+    return;
+  }
+
+  snprintf(to, sizeof(to), "%s.%u", file->path, file->max_files);
+  platform_file_delete(to);
+
+  for (u32 i = file->max_files; i > 1; --i) {
+    snprintf(from, sizeof(from), "%s.%u", file->path, i - 1);
+    snprintf(to, sizeof(to), "%s.%u", file->path, i);
+    platform_file_rename(from, to);
+  }
+
+  snprintf(to, sizeof(to), "%s.1", file->path);
+  platform_file_rename(file->path, to);
+}
+
+// Move on to the window following the current one
+static b8
+log_file_next_window(log_file* file) {
+  if (!file->mapped) {
+    // Buffered fallback: write the full buffer and start over
+    if (!platform_file_append(&file->file, file->window, file->window_used)) {
+      return FALSE;
+    }
+    file->window_offset += file->window_used;
+    file->window_used = 0;
+    return TRUE;
+  }
+
+  // The window is full and the window size is a multiple of the
+  // granularity, so the next window starts exactly where this one ends
+  platform_file_unmap(file->window, file->window_size);
+  file->window_offset += file->window_size;
+  file->window_used = 0;
+
+  if (platform_file_resize(&file->file, file->window_offset + file->window_size)) {
+    file->window = platform_file_map(&file->file, file->window_offset, file->window_size);
+  } else {
+    file->window = 0;
+  }
+
+  if (!file->window) {
+    // Could not grow the mapping. Trim and carry on with buffered writes
+    P_WARN("Log file '%s' could not be remapped. Falling back to buffered writes", file->path);
+    platform_file_resize(&file->file, file->window_offset);
+    file->mapped = FALSE;
+    file->window = platform_allocate(file->window_size, FALSE);
+  }
+
+  return TRUE;
+}
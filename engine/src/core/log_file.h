@@ -0,0 +1,69 @@
+/**
+ * Rolling log file
+ *
+ * Appends go through a memory-mapped window of the file, so writing a
+ * line is a memcpy rather than a syscall. When the window fills, the file
+ * is grown and the next window is mapped. If mapping is unavailable the
+ * window is an ordinary buffer written out when it fills.
+ *
+ * When the file would grow past max_size it is rotated:
+ * path -> path.1 -> path.2 ... up to max_files, and a fresh file is started.
+*/
+#pragma once
+
+#include "defines.h"
+#include "platform/platform.h"
+
+// Largest header that is rewritten at the start of every rotated file
+#define LOG_FILE_MAX_HEADER_SIZE 32
+
+typedef struct log_file {
+  platform_file file;
+  char path[256];
+
+  // Rotation policy
+  u64 max_size;
+  u32 max_files;
+
+  // Written to the start of each new file
+  u8 header[LOG_FILE_MAX_HEADER_SIZE];
+  u32 header_size;
+
+  // Current window
+  u8* window;
+  u64 window_offset; // file offset the window starts at
+  u64 window_size;
+  u64 window_used;   // bytes of the window holding data
+  b8 mapped;         // FALSE if the window is a plain buffer
+
+  // Incremented every time the file is rotated
+  u32 generation;
+} log_file;
+
+/*
+  Open a log file. An existing file from a previous run is rotated out first
+  @param out_file - file to initialize
+  @param path - path of the active log file
+  @param max_size - rotate once the file would exceed this many bytes. 0 for the default
+  @param max_files - number of rotated files to keep
+  @param header - bytes written at the start of every file, may be NULL
+  @param header_size - size of header, up to LOG_FILE_MAX_HEADER_SIZE
+  @returns TRUE on success
+*/
+b8 log_file_open(log_file* out_file, const char* path, u64 max_size, u32 max_files, const void* header, u32 header_size);
+
+// Unmap, trim the file to the bytes actually written and close it
+void log_file_close(log_file* file);
+
+/*
+  Rotate now if appending size more bytes would exceed the size limit.
+  Call before a group of appends that must stay in the same file
+  @returns TRUE if the file was rotated
+*/
+b8 log_file_prepare(log_file* file, u64 size);
+
+// Append bytes to the file
+b8 log_file_append(log_file* file, const void* data, u64 size);
+
+// Force everything appended so far through to the file on disk
+void log_file_flush(log_file* file);
@@ -1,22 +1,254 @@
 #include "logger.h"
 #include "assert.h"
 #include "platform/platform.h"
+#include "platform/platform_atomic.h"
+#include "core/pmemory.h"
+#include "core/log_deferred.h"
+#include "core/log_file.h"
+#include "core/profiler.h"
 
 // TODO: temporary
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
 
+// Longest message a single entry can hold, including the level prefix.
+// Anything longer is truncated
+#define LOG_ENTRY_MAX_LENGTH 2048
+
+// Number of entries in the queue. Must be a power of 2
+#define LOG_QUEUE_CAPACITY 512
+
+// How many times a producer retries a full queue before dropping its message.
+// This bounds the time a caller can spend inside log_output
+#define LOG_ENQUEUE_MAX_SPINS 256
+
+// Longest time a flush will wait for the writer to drain the queue
+#define LOG_FLUSH_TIMEOUT_MS 1000
+
+// Call sites with suppressed messages that can wait to be reported on flush.
+// Sites beyond this are still reported the next time they log
+#define LOG_MAX_SUPPRESSED_SITES 64
+
+// Size of the table remembering which format strings are already in the binary log.
+// Must be a power of 2
+#define LOG_FORMAT_TABLE_SIZE 4096
+
+/**
+ * A single queued message.
+ * sequence tells producers and the writer who owns the slot:
+ *  - sequence == position      : free for the producer claiming 'position'
+ *  - sequence == position + 1  : written and ready for the writer
+*/
+typedef struct log_entry {
+  u64 sequence;
+  log_level level;
+  u32 length;
+  // Set for deferred entries, in which case message holds the captured arguments
+  const char* format;
+  f64 timestamp;
+  char message[LOG_ENTRY_MAX_LENGTH];
+} log_entry;
+
+typedef struct logger_system_state {
+  log_entry entries[LOG_QUEUE_CAPACITY];
+
+  // Next position producers will claim. Shared by all producers
+  u64 write_index;
+  // Next position the writer will consume. Only written by the writer thread
+  u64 read_index;
+
+  // Messages thrown away because the queue stayed full
+  u64 dropped_count;
+
+  // Set by the writer before it blocks, so producers know to wake it
+  u32 writer_sleeping;
+  b8 running;
+
+  platform_thread writer_thread;
+  platform_semaphore wake_semaphore;
+
+  // File outputs. Only touched by the writer thread once it is running
+  b8 text_file_open;
+  log_file text_file;
+  b8 binary_file_open;
+  log_file binary_file;
+  u64 binary_formats[LOG_FORMAT_TABLE_SIZE];
+  u32 binary_format_count;
+  // Set by log_forget_formats for the writer to empty binary_formats
+  b8 binary_formats_stale;
+
+  // Scratch space the writer formats deferred entries into
+  char writer_buffer[LOG_ENTRY_MAX_LENGTH];
+
+  // Call sites that dropped messages since the last report
+  platform_mutex suppressed_lock;
+  log_call_site* suppressed_sites[LOG_MAX_SUPPRESSED_SITES];
+  u32 suppressed_site_count;
+} logger_system_state;
+
+static const char* level_strings[6] = {
+  "[FATAL]",
+  "[ERROR]",
+  "[WARN]",
+  "[INFO]",
+  "[DEBUG]",
+  "[TRACE]"
+};
+
+// Format id under which already formatted messages are stored in the binary log
+static const char* preformatted_format = "%s";
+
+static b8 initialized = FALSE;
+static logger_system_state state;
+
+// Everything compiled in is logged until told otherwise
+log_level log_category_levels[LOG_CATEGORY_MAX_CATEGORIES] = {
+  LOG_LEVEL_TRACE,
+  LOG_LEVEL_TRACE,
+  LOG_LEVEL_TRACE,
+  LOG_LEVEL_TRACE
+};
+
+// Messages per second each call site may log. 0 is unlimited
+#define LOG_DEFAULT_RATE_LIMIT 50
+static u32 rate_limit = LOG_DEFAULT_RATE_LIMIT;
+
+static u32 log_writer_thread(void* params);
+static void log_write_entry(log_level level, const char* message);
+static void log_write_binary(log_entry* entry);
+static void log_write_text_file(log_entry* entry, const char* message);
+static void log_wake_writer();
+static log_entry* log_claim_entry(u64* out_position);
+static void log_publish_entry(log_entry* entry, u64 position);
+static u32 log_format_entry(char* buffer, log_level level, const char* message, va_list arg_ptr);
+static void log_report_suppressed();
+static void log_wait_written(b8 bounded);
+
 b8
-initialize_logging() {
-  // TODO: create a log filea
+initialize_logging(logger_config* config) {
+  if (initialized) {
+    return FALSE;
+  }
+
+  pzero_memory(&state, sizeof(state));
+  for (u64 i = 0; i < LOG_QUEUE_CAPACITY; ++i) {
+    state.entries[i].sequence = i;
+  }
+
+  if (config && config->log_file_path) {
+    state.text_file_open = log_file_open(
+      &state.text_file,
+      config->log_file_path,
+      config->max_file_size,
+      config->max_file_count,
+      0,
+      0);
+    if (!state.text_file_open) {
+      P_ERROR("Unable to create log file '%s'", config->log_file_path);
+    }
+  }
+
+  if (config && config->binary_log_path) {
+    u32 header[2] = {LOG_BINARY_MAGIC, LOG_BINARY_VERSION};
+    state.binary_file_open = log_file_open(
+      &state.binary_file,
+      config->binary_log_path,
+      config->max_file_size,
+      config->max_file_count,
+      header,
+      sizeof(header));
+    if (!state.binary_file_open) {
+      P_ERROR("Unable to create binary log '%s'", config->binary_log_path);
+    }
+  }
+
+  if (!platform_semaphore_create(0, &state.wake_semaphore)) {
+    P_ERROR("Unable to create the log writer semaphore. Logging will stay synchronous");
+    return FALSE;
+  }
+
+  if (!platform_mutex_create(&state.suppressed_lock)) {
+    P_ERROR("Unable to create the log rate limit mutex. Logging will stay synchronous");
+    platform_semaphore_destroy(&state.wake_semaphore);
+    return FALSE;
+  }
+
+  state.running = TRUE;
+  if (!platform_thread_create(log_writer_thread, 0, &state.writer_thread)) {
+    P_ERROR("Unable to start the log writer thread. Logging will stay synchronous");
+    state.running = FALSE;
+    platform_mutex_destroy(&state.suppressed_lock);
+    platform_semaphore_destroy(&state.wake_semaphore);
+    return FALSE;
+  }
+
+  platform_atomic_store_b8(&initialized, TRUE, PLATFORM_MEMORY_ORDER_RELEASE);
   return TRUE;
 }
 
 void
 shutdown_loggin() {
-  // TODO: cleanup logging/write queued entries
-  return;
+  if (!initialized) {
+    return;
+  }
+
+  // A burst that stopped before its call site logged again has not been reported yet
+  log_report_suppressed();
+
+  // Stop accepting queued messages. Anything logged from here on is written directly
+  platform_atomic_store_b8(&initialized, FALSE, PLATFORM_MEMORY_ORDER_RELEASE);
+
+  // The writer drains whatever is left in the queue before it exits
+  platform_atomic_store_b8(&state.running, FALSE, PLATFORM_MEMORY_ORDER_RELEASE);
+  platform_semaphore_signal(&state.wake_semaphore);
+  platform_thread_join(&state.writer_thread);
+  platform_semaphore_destroy(&state.wake_semaphore);
+  platform_mutex_destroy(&state.suppressed_lock);
+
+  if (state.text_file_open) {
+    log_file_close(&state.text_file);
+    state.text_file_open = FALSE;
+  }
+  if (state.binary_file_open) {
+    log_file_close(&state.binary_file);
+    state.binary_file_open = FALSE;
+  }
+}
+
+void
+log_flush() {
+  log_wait_written(TRUE);
+}
+
+void
+log_drain() {
+  log_wait_written(FALSE);
+}
+
+// Wait until everything enqueued before this call has been written.
+// Bounded waits give up after LOG_FLUSH_TIMEOUT_MS
+static void
+log_wait_written(b8 bounded) {
+  if (!platform_atomic_load_b8(&initialized, PLATFORM_MEMORY_ORDER_ACQUIRE)) {
+    return;
+  }
+
+  log_report_suppressed();
+
+  u64 target = platform_atomic_load_u64(&state.write_index, PLATFORM_MEMORY_ORDER_ACQUIRE);
+  for (u64 waited = 0; !bounded || waited < LOG_FLUSH_TIMEOUT_MS; ++waited) {
+    if (platform_atomic_load_u64(&state.read_index, PLATFORM_MEMORY_ORDER_ACQUIRE) >= target) {
+      return;
+    }
+    log_wake_writer();
+    platform_sleep(1);
+  }
+}
+
+void
+log_forget_formats() {
+  platform_atomic_store_b8(&state.binary_formats_stale, TRUE, PLATFORM_MEMORY_ORDER_RELEASE);
 }
 
 /*
@@ -24,39 +256,419 @@ shutdown_loggin() {
 */
 void
 log_output(log_level level, const char* message, ...) {
-  const char* level_strings[6] = {
-    "[FATAL]",
-    "[ERROR]",
-    "[WARN]",
-    "[INFO]",
-    "[DEBUG]",
-    "[TRACE]"
-  };
+  va_list arg_ptr;
 
-  b8 is_error = level < LOG_LEVEL_WARN;
+  // Before initialization and after shutdown there is no writer, so write directly
+  if (!platform_atomic_load_b8(&initialized, PLATFORM_MEMORY_ORDER_ACQUIRE)) {
+    char out_message[LOG_ENTRY_MAX_LENGTH];
+    va_start(arg_ptr, message);
+    log_format_entry(out_message, level, message, arg_ptr);
+    va_end(arg_ptr);
 
-  // Massive buffer to avoid runtime allocations that are slow
-  const i32 msg_length = 32000;
-  char err_message[msg_length];
-  memset(err_message, 0, sizeof(err_message));
+    log_write_entry(level, out_message);
+    return;
+  }
+
+  // A full queue drops the message, already counted by log_claim_entry.
+  // Writing it here instead would put console and file I/O on the caller's thread
+  u64 position = 0;
+  log_entry* entry = log_claim_entry(&position);
+  if (!entry) {
+    return;
+  }
 
-  // Format the message
-  __builtin_va_list arg_ptr;
+  // Format straight into the slot, then publish it to the writer
   va_start(arg_ptr, message);
-  vsnprintf(err_message, msg_length, message, arg_ptr);
+  entry->length = log_format_entry(entry->message, level, message, arg_ptr);
   va_end(arg_ptr);
+  entry->level = level;
+  entry->format = 0;
+  entry->timestamp = platform_get_absolute_time();
+  log_publish_entry(entry, position);
+
+  // Fatal messages must be out before the application goes down
+  if (level == LOG_LEVEL_FATAL) {
+    log_flush();
+  }
+}
+
+void
+log_output_deferred(log_level level, const char* format, ...) {
+  va_list arg_ptr;
 
-  // Prepend the error level to the message string
-  char out_message[msg_length];
-  memset(out_message, 0, sizeof(out_message));
-  sprintf(out_message, "%s%s\n", level_strings[level], err_message);
+  // Before initialization and after shutdown there is no writer, so write directly
+  if (!platform_atomic_load_b8(&initialized, PLATFORM_MEMORY_ORDER_ACQUIRE)) {
+    char out_message[LOG_ENTRY_MAX_LENGTH];
+    va_start(arg_ptr, format);
+    log_format_entry(out_message, level, format, arg_ptr);
+    va_end(arg_ptr);
+
+    log_write_entry(level, out_message);
+    return;
+  }
+
+  // A full queue drops the message, already counted by log_claim_entry.
+  // Writing it here instead would put console and file I/O on the caller's thread
+  u64 position = 0;
+  log_entry* entry = log_claim_entry(&position);
+  if (!entry) {
+    return;
+  }
+
+  // Only copy the raw arguments. The writer formats them
+  va_start(arg_ptr, format);
+  entry->length = log_deferred_capture(entry->message, LOG_ENTRY_MAX_LENGTH, format, arg_ptr);
+  va_end(arg_ptr);
+  entry->level = level;
+  entry->format = format;
+  entry->timestamp = platform_get_absolute_time();
+  log_publish_entry(entry, position);
+}
+
+void
+log_set_level(log_category category, log_level level) {
+  if (category >= LOG_CATEGORY_MAX_CATEGORIES) {
+    return;
+  }
+  log_category_levels[category] = level;
+}
+
+log_level
+log_get_level(log_category category) {
+  if (category >= LOG_CATEGORY_MAX_CATEGORIES) {
+    return LOG_LEVEL_FATAL;
+  }
+  return log_category_levels[category];
+}
+
+void
+log_set_rate_limit(u32 messages_per_second) {
+  rate_limit = messages_per_second;
+}
+
+// Counts are approximate when one call site is hit from several threads at once.
+// That only shifts where the limit cuts in, which is all it has to do
+b8
+log_call_site_allow(log_call_site* site, log_level level, const char* file, i32 line) {
+  u32 limit = rate_limit;
+  if (limit == 0) {
+    return TRUE;
+  }
+
+  // Under the limit, the message is allowed wherever the second stands.
+  // The clock is only read to open a window and once the limit is reached
+  u32 count = site->count;
+  if (count != 0 && count < limit) {
+    site->count = count + 1;
+    return TRUE;
+  }
+
+  f64 now = platform_get_absolute_time();
+  if (count == 0 || now - site->window_start >= 1.0) {
+    // A new second. Report what the last one dropped
+    u32 suppressed = site->suppressed;
+    site->window_start = now;
+    site->count = 1;
+    site->suppressed = 0;
+
+    if (suppressed) {
+      log_output(level, "%s:%d suppressed %u messages", file, line, suppressed);
+    }
+    return TRUE;
+  }
+
+  site->suppressed++;
+
+  // Remember the site, so the drops are reported on flush even if it never logs again
+  if (!site->registered && platform_atomic_load_b8(&initialized, PLATFORM_MEMORY_ORDER_ACQUIRE)) {
+    platform_mutex_lock(&state.suppressed_lock);
+    if (!site->registered && state.suppressed_site_count < LOG_MAX_SUPPRESSED_SITES) {
+      site->file = file;
+      site->line = line;
+      site->level = level;
+      site->registered = TRUE;
+      state.suppressed_sites[state.suppressed_site_count++] = site;
+    }
+    platform_mutex_unlock(&state.suppressed_lock);
+  }
+  return FALSE;
+}
+
+// Report and reset the drops of every remembered call site
+static void
+log_report_suppressed() {
+  // Take the list first. Reporting logs, and a fatal report flushes back into here
+  log_call_site* sites[LOG_MAX_SUPPRESSED_SITES];
+  platform_mutex_lock(&state.suppressed_lock);
+  u32 site_count = state.suppressed_site_count;
+  pcopy_memory(sites, state.suppressed_sites, sizeof(log_call_site*) * site_count);
+  state.suppressed_site_count = 0;
+  for (u32 i = 0; i < site_count; ++i) {
+    sites[i]->registered = FALSE;
+  }
+  platform_mutex_unlock(&state.suppressed_lock);
+
+  for (u32 i = 0; i < site_count; ++i) {
+    log_call_site* site = sites[i];
+    u32 suppressed = site->suppressed;
+    if (suppressed) {
+      site->suppressed = 0;
+      log_output(site->level, "%s:%d suppressed %u messages", site->file, site->line, suppressed);
+    }
+  }
+}
+
+// Claim a free slot in the queue. Returns 0 if the queue stayed full
+static log_entry*
+log_claim_entry(u64* out_position) {
+  u64 position = platform_atomic_load_u64(&state.write_index, PLATFORM_MEMORY_ORDER_RELAXED);
+  for (u32 spins = 0; spins < LOG_ENQUEUE_MAX_SPINS;) {
+    log_entry* entry = &state.entries[position & (LOG_QUEUE_CAPACITY - 1)];
+    u64 sequence = platform_atomic_load_u64(&entry->sequence, PLATFORM_MEMORY_ORDER_ACQUIRE);
+    i64 difference = (i64)sequence - (i64)position;
+
+    if (difference == 0) {
+      // Slot is free. Try to take it before another producer does
+      if (platform_atomic_compare_exchange_u64(&state.write_index, &position, position + 1, PLATFORM_MEMORY_ORDER_RELAXED)) {
+        *out_position = position;
+        return entry;
+      }
+      // position was reloaded by the failed exchange
+    } else if (difference < 0) {
+      // Queue is full. Nudge the writer and retry a bounded number of times
+      log_wake_writer();
+      spins++;
+      position = platform_atomic_load_u64(&state.write_index, PLATFORM_MEMORY_ORDER_RELAXED);
+    } else {
+      // Another producer took this slot
+      position = platform_atomic_load_u64(&state.write_index, PLATFORM_MEMORY_ORDER_RELAXED);
+    }
+  }
+
+  platform_atomic_fetch_add_u64(&state.dropped_count, 1, PLATFORM_MEMORY_ORDER_RELAXED);
+  return 0;
+}
+
+// Hand a filled slot to the writer
+static void
+log_publish_entry(log_entry* entry, u64 position) {
+  platform_atomic_store_u64(&entry->sequence, position + 1, PLATFORM_MEMORY_ORDER_RELEASE);
+  log_wake_writer();
+}
+
+// Write the level prefix and formatted message into buffer. Returns the length written
+static u32
+log_format_entry(char* buffer, log_level level, const char* message, va_list arg_ptr) {
+  u32 prefix_length = (u32)strlen(level_strings[level]);
+  pcopy_memory(buffer, level_strings[level], prefix_length);
+
+  // Leave room for the trailing newline and terminator
+  u32 available = LOG_ENTRY_MAX_LENGTH - prefix_length - 1;
+  i32 written = vsnprintf(buffer + prefix_length, available, message, arg_ptr);
+  if (written < 0) {
+    written = 0;
+  } else if ((u32)written >= available) {
+    written = available - 1;
+  }
+
+  u32 length = prefix_length + written;
+  buffer[length++] = '\n';
+  buffer[length] = 0;
+  return length;
+}
+
+static void
+log_write_entry(log_level level, const char* message) {
+  b8 is_error = level < LOG_LEVEL_WARN;
 
-  // Print the error message
   if (is_error) {
-    platform_console_write_error(out_message, level);
+    platform_console_write_error(message, level);
   } else {
-    platform_console_write(out_message, level);
+    platform_console_write(message, level);
+  }
+}
+
+// Append an entry to the binary log, defining its format string on first use
+static void
+log_write_binary(log_entry* entry) {
+  const char* format = entry->format;
+  const char* args = entry->message;
+  u32 args_length = entry->length;
+
+  // Already formatted messages are stored as a single string argument.
+  // The prefix and newline are dropped since the record carries the level
+  char preformatted[LOG_ENTRY_MAX_LENGTH];
+  if (!format) {
+    u32 prefix_length = (u32)strlen(level_strings[entry->level]);
+    u16 text_length = (u16)(entry->length - prefix_length - 1);
+    format = preformatted_format;
+    pcopy_memory(preformatted, &text_length, sizeof(u16));
+    pcopy_memory(preformatted + sizeof(u16), entry->message + prefix_length, text_length);
+    args = preformatted;
+    args_length = sizeof(u16) + text_length;
+  }
+
+  // Addresses of formats already written may now belong to other strings
+  if (platform_atomic_exchange_b8(&state.binary_formats_stale, FALSE, PLATFORM_MEMORY_ORDER_ACQUIRE)) {
+    pzero_memory(state.binary_formats, sizeof(state.binary_formats));
+    state.binary_format_count = 0;
+  }
+
+  u64 id = (u64)format;
+  u16 format_length = (u16)strlen(format);
+  u16 stored_length = (u16)args_length;
+
+  // Rotate before writing, so a definition and its first use land in the same file
+  u64 definition_size = sizeof(u8) + sizeof(u64) + sizeof(u16) + format_length;
+  u64 record_size = sizeof(u8) + sizeof(u64) + sizeof(f64) + sizeof(u8) + sizeof(u16) + stored_length;
+  if (log_file_prepare(&state.binary_file, definition_size + record_size)) {
+    // New file: every format must be defined again
+    pzero_memory(state.binary_formats, sizeof(state.binary_formats));
+    state.binary_format_count = 0;
   }
+
+  // Open addressed set of ids already written to this file
+  u64 slot = (id >> 3) & (LOG_FORMAT_TABLE_SIZE - 1);
+  while (state.binary_formats[slot] != 0 && state.binary_formats[slot] != id) {
+    slot = (slot + 1) & (LOG_FORMAT_TABLE_SIZE - 1);
+  }
+
+  if (state.binary_formats[slot] == 0) {
+    u8 record_type = LOG_BINARY_RECORD_FORMAT;
+    log_file_append(&state.binary_file, &record_type, sizeof(u8));
+    log_file_append(&state.binary_file, &id, sizeof(u64));
+    log_file_append(&state.binary_file, &format_length, sizeof(u16));
+    log_file_append(&state.binary_file, format, format_length);
+
+    // Keep the table sparse. Starting over only costs repeated definitions
+    if (++state.binary_format_count > LOG_FORMAT_TABLE_SIZE / 2) {
+      pzero_memory(state.binary_formats, sizeof(state.binary_formats));
+      state.binary_format_count = 0;
+    } else {
+      state.binary_formats[slot] = id;
+    }
+  }
+
+  u8 record_type = LOG_BINARY_RECORD_ENTRY;
+  u8 level = (u8)entry->level;
+  log_file_append(&state.binary_file, &record_type, sizeof(u8));
+  log_file_append(&state.binary_file, &id, sizeof(u64));
+  log_file_append(&state.binary_file, &entry->timestamp, sizeof(f64));
+  log_file_append(&state.binary_file, &level, sizeof(u8));
+  log_file_append(&state.binary_file, &stored_length, sizeof(u16));
+  log_file_append(&state.binary_file, args, stored_length);
+}
+
+// Append a formatted message to the text log, prefixed with its timestamp
+static void
+log_write_text_file(log_entry* entry, const char* message) {
+  char timestamp[32];
+  i32 timestamp_length = snprintf(timestamp, sizeof(timestamp), "[%.6f]", entry->timestamp);
+  u64 message_length = strlen(message);
+
+  log_file_prepare(&state.text_file, timestamp_length + message_length);
+  log_file_append(&state.text_file, timestamp, timestamp_length);
+  log_file_append(&state.text_file, message, message_length);
+}
+
+static void
+log_wake_writer() {
+  if (platform_atomic_exchange_u32(&state.writer_sleeping, 0, PLATFORM_MEMORY_ORDER_SEQ_CST)) {
+    platform_semaphore_signal(&state.wake_semaphore);
+  }
+}
+
+// Background thread that drains the queue and writes entries out
+static u32
+log_writer_thread(void* params) {
+  platform_thread_set_name("log writer");
+  profiler_name_thread("log writer");
+  for (;;) {
+    // Write everything that is ready
+    b8 wrote = FALSE;
+    b8 profiled = profiler_zone_begin("log write");
+    for (;;) {
+      log_entry* entry = &state.entries[state.read_index & (LOG_QUEUE_CAPACITY - 1)];
+      u64 sequence = platform_atomic_load_u64(&entry->sequence, PLATFORM_MEMORY_ORDER_ACQUIRE);
+      if (sequence != state.read_index + 1) {
+        break;
+      }
+
+      if (state.binary_file_open) {
+        log_write_binary(entry);
+      }
+
+      const char* message = entry->message;
+      if (entry->format) {
+        // Deferred entry. Format it here, off the thread that logged it
+        u32 prefix_length = (u32)strlen(level_strings[entry->level]);
+        pcopy_memory(state.writer_buffer, level_strings[entry->level], prefix_length);
+        u32 length = prefix_length + log_deferred_format(
+          state.writer_buffer + prefix_length,
+          LOG_ENTRY_MAX_LENGTH - prefix_length - 1,
+          entry->format,
+          entry->message,
+          entry->length);
+        state.writer_buffer[length++] = '\n';
+        state.writer_buffer[length] = 0;
+        message = state.writer_buffer;
+      }
+
+      log_write_entry(entry->level, message);
+      if (state.text_file_open) {
+        log_write_text_file(entry, message);
+      }
+
+      // Mapped file contents survive the process dying, but not the machine.
+      // Push everything to disk before a fatal error takes the application down
+      if (entry->level == LOG_LEVEL_FATAL) {
+        if (state.text_file_open) {
+          log_file_flush(&state.text_file);
+        }
+        if (state.binary_file_open) {
+          log_file_flush(&state.binary_file);
+        }
+      }
+
+      // Hand the slot back to producers for the next lap around the ring
+      platform_atomic_store_u64(&entry->sequence, state.read_index + LOG_QUEUE_CAPACITY, PLATFORM_MEMORY_ORDER_RELEASE);
+      platform_atomic_store_u64(&state.read_index, state.read_index + 1, PLATFORM_MEMORY_ORDER_RELEASE);
+      wrote = TRUE;
+    }
+
+    if (profiled) {
+      profiler_zone_end();
+    }
+
+    u64 dropped = platform_atomic_exchange_u64(&state.dropped_count, 0, PLATFORM_MEMORY_ORDER_RELAXED);
+    if (dropped) {
+      char notice[128];
+      snprintf(notice, sizeof(notice), "[WARN]Log queue full, dropped %llu messages\n", dropped);
+      log_write_entry(LOG_LEVEL_WARN, notice);
+    }
+
+    if (wrote) {
+      continue;
+    }
+
+    if (!platform_atomic_load_b8(&state.running, PLATFORM_MEMORY_ORDER_ACQUIRE)) {
+      // Queue is empty and shutdown was requested
+      break;
+    }
+
+    // Announce that we are about to sleep, then check once more so a
+    // message published in between is not left waiting for the next one
+    platform_atomic_store_u32(&state.writer_sleeping, 1, PLATFORM_MEMORY_ORDER_SEQ_CST);
+    log_entry* next = &state.entries[state.read_index & (LOG_QUEUE_CAPACITY - 1)];
+    if (platform_atomic_load_u64(&next->sequence, PLATFORM_MEMORY_ORDER_ACQUIRE) == state.read_index + 1 ||
+        !platform_atomic_load_b8(&state.running, PLATFORM_MEMORY_ORDER_ACQUIRE)) {
+      platform_atomic_store_u32(&state.writer_sleeping, 0, PLATFORM_MEMORY_ORDER_SEQ_CST);
+      continue;
+    }
+    platform_semaphore_wait(&state.wake_semaphore, PLATFORM_WAIT_INFINITE);
+  }
+
+  return 0;
 }
 
 // ASSERTIONS //
@@ -68,4 +680,4 @@ report_assertion_failure(
   i32 line
 ) {
   log_output(LOG_LEVEL_FATAL, "Assertion Failure: %s, message: '%s', in file '%s', line %d\n", expression, message, file, line);
-}
\ No newline at end of file
+}
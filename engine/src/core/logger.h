@@ -22,41 +22,179 @@ typedef enum log_level {
   LOG_LEVEL_TRACE = 5
 } log_level;
 
-b8 initialize_logging();
+// Subsystem a message comes from. Each has its own runtime level
+typedef enum log_category {
+  LOG_CATEGORY_CORE,
+  LOG_CATEGORY_PLATFORM,
+  LOG_CATEGORY_RENDERER,
+  LOG_CATEGORY_GAME,
+  LOG_CATEGORY_MAX_CATEGORIES
+} log_category;
+
+// Category used by the log macros in the current file.
+// Define P_LOG_CATEGORY before any include to override it for a file
+#ifndef P_LOG_CATEGORY
+#ifdef PEXPORT
+#define P_LOG_CATEGORY LOG_CATEGORY_CORE
+#else
+#define P_LOG_CATEGORY LOG_CATEGORY_GAME
+#endif
+#endif
+
+// Most verbose level logged per category. Read by the log macros; change it with log_set_level
+P_API extern log_level log_category_levels[LOG_CATEGORY_MAX_CATEGORIES];
+
+// Per call site rate limiting state. Lives in a static inside each log macro expansion
+typedef struct log_call_site {
+  f64 window_start;
+  u32 count;
+  u32 suppressed;
+
+  // Where the site is, for reporting suppressed messages when the log is flushed
+  const char* file;
+  i32 line;
+  log_level level;
+  // The site is waiting in the logger's list of sites with suppressed messages
+  b8 registered;
+} log_call_site;
+
+// When enabled, INFO/DEBUG/TRACE call sites only capture their format string and raw
+// arguments. Formatting happens on the log writer thread, or offline with the log decoder
+#ifndef LOG_DEFERRED_FORMAT_ENABLED
+#define LOG_DEFERRED_FORMAT_ENABLED 1
+#endif
+
+typedef struct logger_config {
+  // Path of the text log file. NULL disables it
+  const char* log_file_path;
+
+  // Path of a compact binary log receiving every message. NULL disables it.
+  // Decode it with log_binary_decode_file or the logdecode tool
+  const char* binary_log_path;
+
+  // Log files are rotated once they would grow past this many bytes. 0 for the default (64MiB)
+  u64 max_file_size;
+  // Number of rotated files kept next to each log (path.1, path.2, ...)
+  u32 max_file_count;
+} logger_config;
+
+// Starts the background writer. Messages logged before this are written synchronously.
+// config may be NULL for defaults
+b8 initialize_logging(logger_config* config);
+// Writes out everything still queued and stops the background writer
 void shutdown_loggin();
 
+/*
+  Queue a message for the background writer. Never blocks for long:
+  if the queue stays full the message is dropped and counted instead.
+  FATAL messages flush the queue and are written before this returns
+*/
 P_API void log_output(log_level level, const char* message, ...);
 
+/*
+  Queue a message without formatting it. format must be a string literal:
+  its address identifies the message and the arguments are stored raw
+*/
+P_API void log_output_deferred(log_level level, const char* format, ...);
+
+// Report messages call sites have suppressed, then block until every message
+// queued before this call has been written, or a second has passed
+P_API void log_flush();
+
+// Like log_flush, but without the time limit. For when queued messages must
+// not outlive something they point to
+P_API void log_drain();
+
+/*
+  Call before unloading a module that logs, after log_drain. Deferred
+  messages are known by the address of their format string, and a module
+  loaded later may reuse those addresses for different strings. Makes the
+  binary log define every format again
+*/
+P_API void log_forget_formats();
+
+// Set the most verbose level logged for a category
+P_API void log_set_level(log_category category, log_level level);
+P_API log_level log_get_level(log_category category);
+
+/*
+  Limit how many messages a single call site may log per second. Further
+  messages in the same second are dropped, and the count is reported the
+  next time that call site logs, or on the next flush or shutdown if it
+  never logs again. FATAL is never limited.
+  @param messages_per_second - limit per call site. 0 disables rate limiting
+*/
+P_API void log_set_rate_limit(u32 messages_per_second);
+
+/*
+  Used by the log macros: counts a message against its call site's rate limit
+  @returns TRUE if the message should be logged
+*/
+P_API b8 log_call_site_allow(log_call_site* site, log_level level, const char* file, i32 line);
+
+#if LOG_DEFERRED_FORMAT_ENABLED == 1
+// The empty literal makes a non-literal format a compile error
+#define P_LOG_DEFERRABLE(level, message, ...) log_output_deferred(level, "" message, ##__VA_ARGS__)
+#else
+#define P_LOG_DEFERRABLE(level, message, ...) log_output(level, message, ##__VA_ARGS__)
+#endif
+
+// Every log call is checked against the level of its category at runtime
+#define P_LOG_ENABLED(level) ((level) <= log_category_levels[P_LOG_CATEGORY])
+
+// Checks the runtime level, then the call site's rate limit, before any argument is evaluated.
+// Each expansion gets its own call site state
+#define P_LOG_CHECKED(level, output)                                         \
+do {                                                                         \
+  static log_call_site p_log_call_site;                                      \
+  if (P_LOG_ENABLED(level) &&                                                \
+      log_call_site_allow(&p_log_call_site, level, __FILE__, __LINE__)) {    \
+    output;                                                                  \
+  }                                                                          \
+} while (0)
+
+// Checks the runtime level only. For reports that log a line per item, where a rate limit would cut them short
+#define P_LOG_UNLIMITED(level, output)                                       \
+do {                                                                         \
+  if (P_LOG_ENABLED(level)) {                                                \
+    output;                                                                  \
+  }                                                                          \
+} while (0)
+
 #ifndef P_FATAL
-#define P_FATAL(message, ...) log_output(LOG_LEVEL_FATAL, message, ##__VA_ARGS__);
+// Fatal messages are never filtered or rate limited
+#define P_FATAL(message, ...) log_output(LOG_LEVEL_FATAL, message, ##__VA_ARGS__)
 #endif
 
 #ifndef P_ERROR
 // log error-level msg
-#define P_ERROR(message, ...) log_output(LOG_LEVEL_ERROR, message, ##__VA_ARGS__);
+#define P_ERROR(message, ...) P_LOG_CHECKED(LOG_LEVEL_ERROR, log_output(LOG_LEVEL_ERROR, message, ##__VA_ARGS__))
 #endif // P_ERROR
 
 #if LOG_WARN_ENABLED == 1
 // log warning-level msg
-#define P_WARN(message, ...) log_output(LOG_LEVEL_WARN, message, ##__VA_ARGS__);
+#define P_WARN(message, ...) P_LOG_CHECKED(LOG_LEVEL_WARN, log_output(LOG_LEVEL_WARN, message, ##__VA_ARGS__))
 #else
-#define P_WARN(message ....)
+#define P_WARN(message, ...)
 #endif
 
 #if LOG_INFO_ENABLED == 1
-#define P_INFO(message, ...) log_output(LOG_LEVEL_INFO, message, ##__VA_ARGS__);
+#define P_INFO(message, ...) P_LOG_CHECKED(LOG_LEVEL_INFO, P_LOG_DEFERRABLE(LOG_LEVEL_INFO, message, ##__VA_ARGS__))
+// Info that is never rate limited, for the lines of a report
+#define P_INFO_UNLIMITED(message, ...) P_LOG_UNLIMITED(LOG_LEVEL_INFO, P_LOG_DEFERRABLE(LOG_LEVEL_INFO, message, ##__VA_ARGS__))
 #else
 #define P_INFO(message, ...)
+#define P_INFO_UNLIMITED(message, ...)
 #endif
 
 #if LOG_DEBUG_ENABLED == 1
-#define P_DEBUG(message, ...) log_output(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__);
+#define P_DEBUG(message, ...) P_LOG_CHECKED(LOG_LEVEL_DEBUG, P_LOG_DEFERRABLE(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__))
 #else
 #define P_DEBUG(message, ...)
 #endif
 
 #if LOG_TRACE_ENABLED == 1
-#define P_TRACE(message, ...) log_output(LOG_LEVEL_TRACE, message, ##__VA_ARGS__);
+#define P_TRACE(message, ...) P_LOG_CHECKED(LOG_LEVEL_TRACE, P_LOG_DEFERRABLE(LOG_LEVEL_TRACE, message, ##__VA_ARGS__))
 #else
 #define P_TRACE(message, ...)
 #endif
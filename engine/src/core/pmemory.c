@@ -2,6 +2,7 @@
 
 #include "logger.h"
 #include "platform/platform.h"
+#include "platform/platform_atomic.h"
 #include "core/pstring.h"
 
 #include <string.h>
@@ -47,8 +48,9 @@ pallocate(u64 size, memory_tag tag) {
     P_WARN("pallocate called using MEMORY_TAG_UNKNWON. Re-class this allocation");
   }
 
-  stats.total_allocated += size;
-  stats.tagged_allocations[tag] += size;
+  // Job workers allocate too
+  platform_atomic_fetch_add_u64(&stats.total_allocated, size, PLATFORM_MEMORY_ORDER_RELAXED);
+  platform_atomic_fetch_add_u64(&stats.tagged_allocations[tag], size, PLATFORM_MEMORY_ORDER_RELAXED);
 
   // TODO: Memory alignment
   void* block = platform_allocate(size, FALSE);
@@ -62,8 +64,8 @@ pfree(void* block, u64 size, memory_tag tag) {
     P_WARN("pallocate called using MEMORY_TAG_UNKNWON. Re-class this allocation");
   }
 
-  stats.total_allocated -= size;
-  stats.tagged_allocations[tag] -= size;
+  platform_atomic_fetch_sub_u64(&stats.total_allocated, size, PLATFORM_MEMORY_ORDER_RELAXED);
+  platform_atomic_fetch_sub_u64(&stats.tagged_allocations[tag], size, PLATFORM_MEMORY_ORDER_RELAXED);
 
   // TODO: memory alignment
   platform_free(block, FALSE);
@@ -0,0 +1,799 @@
+#include "profiler.h"
+#include "logger.h"
+#include "platform/platform.h"
+#include "platform/platform_atomic.h"
+#include "core/pmemory.h"
+
+// TODO: temporary
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+// Events each thread can hold between two calls to profiler_frame_end. Must be a power of 2
+#define PROFILER_RING_CAPACITY 16384
+
+// Threads that can record zones over the life of the profiler
+#define PROFILER_MAX_THREADS 64
+
+#define PROFILER_NO_ZONE 0xFFFFFFFF
+
+// Trace output is staged here and appended to the capture file when full
+#define PROFILER_CAPTURE_BUFFER_SIZE 65536
+
+// Room left in the capture buffer before it is written out. Larger than any single trace event
+#define PROFILER_CAPTURE_FLUSH_MARGIN 512
+
+// A zone begin or end, as recorded by the thread it happened on
+typedef struct profiler_event {
+  u64 ticks;
+  // Name of the zone being entered. 0 marks the end of the innermost zone
+  const char* name;
+} profiler_event;
+
+typedef struct profiler_thread {
+  profiler_event events[PROFILER_RING_CAPACITY];
+
+  // Only written by the owning thread
+  u64 write_index;
+  // Only written by the thread draining the rings in profiler_frame_end
+  u64 read_index;
+
+  // Owning thread only: zones currently open that were recorded / skipped.
+  // Once a zone is skipped everything nested inside it is skipped too
+  u32 recorded_depth;
+  u32 skipped_depth;
+  // Zones skipped because the ring was full or too deeply nested
+  u64 dropped;
+
+  u32 index;
+  char name[PROFILER_MAX_NAME_LENGTH];
+
+  // Draining thread only: set once the current capture has named this thread
+  b8 capture_named;
+
+  // Hardware counter readings, parallel to events. Only allocated for the
+  // thread that turned counters on, which is also the draining thread
+  platform_perf_counters* counters;
+
+  // Draining thread only: zones this thread currently has open
+  u32 root;
+  u32 depth;
+  u32 stack[PROFILER_MAX_DEPTH];
+  u64 stack_ticks[PROFILER_MAX_DEPTH];
+  platform_perf_counters stack_counters[PROFILER_MAX_DEPTH];
+} profiler_thread;
+
+typedef struct profiler_zone {
+  char name[PROFILER_MAX_NAME_LENGTH];
+  // Address of the name as last recorded, to match events without comparing strings
+  const char* literal;
+  u32 thread_index;
+  u32 depth;
+
+  // Tree links, all zone indices
+  u32 parent;
+  u32 first_child;
+  u32 last_child;
+  u32 next_sibling;
+  // Position in depth first order
+  u32 order_index;
+
+  // Accumulated while draining the current frame
+  u64 frame_ticks;
+  u32 frame_calls;
+
+  u64 last_ticks;
+  u64 min_ticks;
+  u64 max_ticks;
+  u64 total_ticks;
+  u64 frames;
+  u64 calls;
+
+  // Hardware counter deltas, the same way as ticks
+  u64 frame_counters[PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+  u64 last_counters[PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+  u64 total_counters[PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+} profiler_zone;
+
+typedef struct profiler_system_state {
+  b8 initialized;
+  b8 enabled;
+
+  f64 ticks_per_second;
+
+  // Slots are claimed with an atomic increment, so the count may run past PROFILER_MAX_THREADS
+  u32 thread_count;
+  profiler_thread* threads[PROFILER_MAX_THREADS];
+
+  // Only touched by the thread calling profiler_frame_end
+  profiler_zone zones[PROFILER_MAX_ZONES];
+  u32 zone_count;
+  u32 first_root;
+  u32 last_root;
+  u32 order[PROFILER_MAX_ZONES];
+  b8 order_dirty;
+  u64 frame_count;
+
+  f64 report_interval;
+  f64 last_report_time;
+
+  // Hardware counters for the thread that calls profiler_frame_end
+  b8 counters_enabled;
+  platform_perf_counters frame_start_counters;
+  platform_perf_counters last_frame_counters;
+
+  // Chrome trace capture. Only touched by the thread calling profiler_frame_end
+  b8 capturing;
+  platform_file capture_file;
+  // Frames still to record. 0 records until profiler_capture_stop
+  u32 capture_frames_left;
+  u64 capture_frame_index;
+  u64 capture_start_ticks;
+  u64 capture_event_count;
+  u32 capture_used;
+  char capture_buffer[PROFILER_CAPTURE_BUFFER_SIZE];
+} profiler_system_state;
+
+static profiler_system_state state;
+
+// Ring of the calling thread, created the first time it begins a zone
+static _Thread_local profiler_thread* current_thread;
+// Name given with profiler_name_thread, used when the ring is created
+static _Thread_local char current_thread_name[PROFILER_MAX_NAME_LENGTH];
+// Set once a thread failed to get a ring, so it does not keep retrying
+static _Thread_local b8 current_thread_rejected;
+
+static profiler_thread*
+profiler_register_thread() {
+  if (current_thread_rejected) {
+    return 0;
+  }
+
+  u32 index = platform_atomic_fetch_add_u32(&state.thread_count, 1, PLATFORM_MEMORY_ORDER_RELAXED);
+  if (index >= PROFILER_MAX_THREADS) {
+    current_thread_rejected = TRUE;
+    P_WARN("profiler: more than %u threads recorded zones. Ignoring zones from thread %llu", PROFILER_MAX_THREADS, platform_current_thread_id());
+    return 0;
+  }
+
+  profiler_thread* thread = pallocate(sizeof(profiler_thread), MEMORY_TAG_APPLICATION);
+  pzero_memory(thread, sizeof(profiler_thread));
+  thread->index = index;
+  thread->root = PROFILER_NO_ZONE;
+  if (current_thread_name[0]) {
+    snprintf(thread->name, sizeof(thread->name), "%s", current_thread_name);
+  } else if (index == 0) {
+    snprintf(thread->name, sizeof(thread->name), "main");
+  } else {
+    snprintf(thread->name, sizeof(thread->name), "thread %llu", platform_current_thread_id());
+  }
+
+  platform_atomic_store_ptr((void* volatile*)&state.threads[index], thread, PLATFORM_MEMORY_ORDER_RELEASE);
+  current_thread = thread;
+  return thread;
+}
+
+b8
+profiler_initialize() {
+  pzero_memory(&state, sizeof(state));
+  state.first_root = PROFILER_NO_ZONE;
+  state.last_root = PROFILER_NO_ZONE;
+  state.ticks_per_second = (f64)platform_get_tick_frequency();
+  state.last_report_time = platform_get_absolute_time();
+  state.initialized = TRUE;
+  state.enabled = TRUE;
+
+  // Claim the first ring so the calling thread shows up as the main thread
+  current_thread = 0;
+  current_thread_rejected = FALSE;
+  profiler_register_thread();
+
+  P_INFO("Profiler initialized. %s timer at %.3f MHz",
+    platform_get_timer_source() == PLATFORM_TIMER_SOURCE_TSC ? "TSC" : "OS",
+    state.ticks_per_second / 1000000.0);
+  return TRUE;
+}
+
+void
+profiler_shutdown() {
+  profiler_capture_stop();
+  if (state.counters_enabled) {
+    profiler_enable_counters(FALSE);
+  }
+  state.enabled = FALSE;
+  state.initialized = FALSE;
+
+  u32 thread_count = state.thread_count < PROFILER_MAX_THREADS ? state.thread_count : PROFILER_MAX_THREADS;
+  for (u32 i = 0; i < thread_count; ++i) {
+    if (state.threads[i]) {
+      pfree(state.threads[i], sizeof(profiler_thread), MEMORY_TAG_APPLICATION);
+      state.threads[i] = 0;
+    }
+  }
+  state.thread_count = 0;
+  current_thread = 0;
+}
+
+void
+profiler_name_thread(const char* name) {
+  snprintf(current_thread_name, sizeof(current_thread_name), "%s", name);
+  if (current_thread && state.initialized) {
+    snprintf(current_thread->name, sizeof(current_thread->name), "%s", name);
+  }
+}
+
+b8
+profiler_zone_begin(const char* name) {
+  if (!platform_atomic_load_b8(&state.enabled, PLATFORM_MEMORY_ORDER_RELAXED)) {
+    return FALSE;
+  }
+
+  profiler_thread* thread = current_thread;
+  if (!thread) {
+    thread = profiler_register_thread();
+    if (!thread) {
+      return FALSE;
+    }
+  }
+
+  // Keep room for the end of every open zone, so an end is never dropped
+  u64 used = thread->write_index - platform_atomic_load_u64(&thread->read_index, PLATFORM_MEMORY_ORDER_ACQUIRE);
+  if (thread->skipped_depth > 0 ||
+      thread->recorded_depth >= PROFILER_MAX_DEPTH ||
+      PROFILER_RING_CAPACITY - used < thread->recorded_depth + 2) {
+    thread->skipped_depth++;
+    platform_atomic_fetch_add_u64(&thread->dropped, 1, PLATFORM_MEMORY_ORDER_RELAXED);
+    return TRUE;
+  }
+
+  profiler_event* event = &thread->events[thread->write_index & (PROFILER_RING_CAPACITY - 1)];
+  event->name = name;
+  event->ticks = platform_get_ticks();
+  if (thread->counters) {
+    platform_perf_counters_read(&thread->counters[thread->write_index & (PROFILER_RING_CAPACITY - 1)]);
+  }
+  thread->recorded_depth++;
+  platform_atomic_store_u64(&thread->write_index, thread->write_index + 1, PLATFORM_MEMORY_ORDER_RELEASE);
+  return TRUE;
+}
+
+void
+profiler_zone_end() {
+  profiler_thread* thread = current_thread;
+  if (!state.initialized || !thread) {
+    return;
+  }
+
+  if (thread->skipped_depth > 0) {
+    thread->skipped_depth--;
+    return;
+  }
+
+  if (thread->recorded_depth == 0) {
+    return;
+  }
+
+  // Counters first so the read itself is not counted against the zone
+  if (thread->counters) {
+    platform_perf_counters_read(&thread->counters[thread->write_index & (PROFILER_RING_CAPACITY - 1)]);
+  }
+  profiler_event* event = &thread->events[thread->write_index & (PROFILER_RING_CAPACITY - 1)];
+  event->ticks = platform_get_ticks();
+  event->name = 0;
+  thread->recorded_depth--;
+  platform_atomic_store_u64(&thread->write_index, thread->write_index + 1, PLATFORM_MEMORY_ORDER_RELEASE);
+}
+
+static u32
+profiler_add_zone(const char* name, u32 parent, u32 thread_index) {
+  if (state.zone_count >= PROFILER_MAX_ZONES) {
+    return PROFILER_NO_ZONE;
+  }
+
+  u32 index = state.zone_count++;
+  profiler_zone* zone = &state.zones[index];
+  pzero_memory(zone, sizeof(profiler_zone));
+  // Copied, as the name may live in a module that is unloaded later
+  snprintf(zone->name, sizeof(zone->name), "%s", name);
+  zone->literal = name;
+  zone->thread_index = thread_index;
+  zone->parent = parent;
+  zone->first_child = PROFILER_NO_ZONE;
+  zone->last_child = PROFILER_NO_ZONE;
+  zone->next_sibling = PROFILER_NO_ZONE;
+  zone->min_ticks = 0xFFFFFFFFFFFFFFFFULL;
+
+  // Append so siblings keep the order they were first seen in
+  u32* first = parent == PROFILER_NO_ZONE ? &state.first_root : &state.zones[parent].first_child;
+  u32* last = parent == PROFILER_NO_ZONE ? &state.last_root : &state.zones[parent].last_child;
+  if (*last == PROFILER_NO_ZONE) {
+    *first = index;
+  } else {
+    state.zones[*last].next_sibling = index;
+  }
+  *last = index;
+
+  zone->depth = parent == PROFILER_NO_ZONE ? 0 : state.zones[parent].depth + 1;
+  state.order_dirty = TRUE;
+  return index;
+}
+
+static u32
+profiler_find_child(u32 parent, const char* name, u32 thread_index) {
+  for (u32 child = state.zones[parent].first_child; child != PROFILER_NO_ZONE; child = state.zones[child].next_sibling) {
+    profiler_zone* zone = &state.zones[child];
+    if (zone->literal == name) {
+      return child;
+    }
+
+    // The same literal can have a different address in another module.
+    // A truncated name matches on the part that was kept
+    if (strncmp(zone->name, name, sizeof(zone->name) - 1) == 0) {
+      zone->literal = name;
+      return child;
+    }
+  }
+
+  return profiler_add_zone(name, parent, thread_index);
+}
+
+static void
+profiler_capture_flush() {
+  if (state.capture_used > 0) {
+    platform_file_append(&state.capture_file, state.capture_buffer, state.capture_used);
+    state.capture_used = 0;
+  }
+}
+
+// Microseconds since the capture started. Zones opened before it are clamped to the start
+static f64
+profiler_capture_time(u64 ticks) {
+  if (ticks < state.capture_start_ticks) {
+    return 0;
+  }
+  return (f64)(ticks - state.capture_start_ticks) * 1000000.0 / state.ticks_per_second;
+}
+
+// Append one trace event object. format holds everything between the braces
+static void
+profiler_capture_write(const char* format, ...) {
+  if (PROFILER_CAPTURE_BUFFER_SIZE - state.capture_used < PROFILER_CAPTURE_FLUSH_MARGIN) {
+    profiler_capture_flush();
+  }
+
+  char* out = state.capture_buffer + state.capture_used;
+  u32 capacity = PROFILER_CAPTURE_BUFFER_SIZE - state.capture_used;
+  i32 length = snprintf(out, capacity, "%s\n{", state.capture_event_count ? "," : "");
+
+  va_list arg_ptr;
+  va_start(arg_ptr, format);
+  length += vsnprintf(out + length, capacity - length, format, arg_ptr);
+  va_end(arg_ptr);
+
+  length += snprintf(out + length, capacity - length, "}");
+  if ((u32)length >= capacity) {
+    // Only a zone name far longer than the margin can get here. Drop the event
+    return;
+  }
+
+  state.capture_used += length;
+  state.capture_event_count++;
+}
+
+// Copy a zone name into a JSON string body
+static const char*
+profiler_capture_escape(const char* name, char* buffer, u32 capacity) {
+  u32 length = 0;
+  for (const char* c = name; *c && length + 2 < capacity; ++c) {
+    if (*c == '"' || *c == '\\') {
+      buffer[length++] = '\\';
+    }
+    buffer[length++] = (u8)*c < 0x20 ? ' ' : *c;
+  }
+  buffer[length] = 0;
+  return buffer;
+}
+
+// Turn a thread's new events into zone time for this frame
+static void
+profiler_drain_thread(profiler_thread* thread) {
+  if (thread->root == PROFILER_NO_ZONE) {
+    thread->root = profiler_add_zone(thread->name, PROFILER_NO_ZONE, thread->index);
+    if (thread->root == PROFILER_NO_ZONE) {
+      return;
+    }
+  }
+
+  char name_buffer[128];
+  if (state.capturing && !thread->capture_named) {
+    profiler_capture_write("\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}",
+      thread->index,
+      profiler_capture_escape(thread->name, name_buffer, sizeof(name_buffer)));
+    thread->capture_named = TRUE;
+  }
+
+  u64 write_index = platform_atomic_load_u64(&thread->write_index, PLATFORM_MEMORY_ORDER_ACQUIRE);
+  for (u64 i = thread->read_index; i < write_index; ++i) {
+    profiler_event* event = &thread->events[i & (PROFILER_RING_CAPACITY - 1)];
+    if (event->name) {
+      u32 parent = thread->depth ? thread->stack[thread->depth - 1] : thread->root;
+      u32 zone = parent == PROFILER_NO_ZONE ? PROFILER_NO_ZONE : profiler_find_child(parent, event->name, thread->index);
+      thread->stack[thread->depth] = zone;
+      thread->stack_ticks[thread->depth] = event->ticks;
+      if (thread->counters) {
+        thread->stack_counters[thread->depth] = thread->counters[i & (PROFILER_RING_CAPACITY - 1)];
+      }
+      thread->depth++;
+    } else if (thread->depth > 0) {
+      thread->depth--;
+      u32 zone = thread->stack[thread->depth];
+      if (zone == PROFILER_NO_ZONE) {
+        continue;
+      }
+
+      u64 elapsed = event->ticks - thread->stack_ticks[thread->depth];
+      state.zones[zone].frame_ticks += elapsed;
+      if (thread->counters) {
+        profiler_zone* root = state.zones[zone].parent == thread->root ? &state.zones[thread->root] : 0;
+        platform_perf_counters* end = &thread->counters[i & (PROFILER_RING_CAPACITY - 1)];
+        for (u32 c = 0; c < PLATFORM_PERF_COUNTER_MAX_COUNTERS; ++c) {
+          u64 delta = end->values[c] - thread->stack_counters[thread->depth].values[c];
+          state.zones[zone].frame_counters[c] += delta;
+          if (root) {
+            root->frame_counters[c] += delta;
+          }
+        }
+      }
+
+      // Zones that ended before the capture started are left out of it
+      if (state.capturing && event->ticks >= state.capture_start_ticks) {
+        f64 start = profiler_capture_time(thread->stack_ticks[thread->depth]);
+        profiler_capture_write("\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+          profiler_capture_escape(state.zones[zone].name, name_buffer, sizeof(name_buffer)),
+          start,
+          profiler_capture_time(event->ticks) - start,
+          thread->index);
+      }
+      state.zones[zone].frame_calls++;
+
+      // A thread's root covers the time spent in its outermost zones
+      if (state.zones[zone].parent == thread->root) {
+        state.zones[thread->root].frame_ticks += elapsed;
+        state.zones[thread->root].frame_calls = 1;
+      }
+    }
+  }
+
+  platform_atomic_store_u64(&thread->read_index, write_index, PLATFORM_MEMORY_ORDER_RELEASE);
+}
+
+void
+profiler_frame_end() {
+  if (!state.initialized) {
+    return;
+  }
+
+  u32 thread_count = platform_atomic_load_u32(&state.thread_count, PLATFORM_MEMORY_ORDER_RELAXED);
+  if (thread_count > PROFILER_MAX_THREADS) {
+    thread_count = PROFILER_MAX_THREADS;
+  }
+
+  for (u32 i = 0; i < thread_count; ++i) {
+    // The slot may be claimed but not filled in yet
+    profiler_thread* thread = platform_atomic_load_ptr((void* volatile*)&state.threads[i], PLATFORM_MEMORY_ORDER_ACQUIRE);
+    if (thread) {
+      profiler_drain_thread(thread);
+    }
+  }
+
+  // Fold this frame into each zone's statistics
+  for (u32 i = 0; i < state.zone_count; ++i) {
+    profiler_zone* zone = &state.zones[i];
+    zone->last_ticks = zone->frame_ticks;
+    if (zone->frame_calls > 0) {
+      if (zone->frame_ticks < zone->min_ticks) {
+        zone->min_ticks = zone->frame_ticks;
+      }
+      if (zone->frame_ticks > zone->max_ticks) {
+        zone->max_ticks = zone->frame_ticks;
+      }
+      zone->total_ticks += zone->frame_ticks;
+      zone->frames++;
+      zone->calls += zone->frame_calls;
+    }
+    zone->frame_ticks = 0;
+    zone->frame_calls = 0;
+
+    for (u32 c = 0; c < PLATFORM_PERF_COUNTER_MAX_COUNTERS; ++c) {
+      zone->last_counters[c] = zone->frame_counters[c];
+      zone->total_counters[c] += zone->frame_counters[c];
+      zone->frame_counters[c] = 0;
+    }
+  }
+  state.frame_count++;
+
+  if (state.counters_enabled) {
+    // Whole frame, zoned or not
+    platform_perf_counters now;
+    platform_perf_counters_read(&now);
+    for (u32 c = 0; c < PLATFORM_PERF_COUNTER_MAX_COUNTERS; ++c) {
+      state.last_frame_counters.values[c] = now.values[c] - state.frame_start_counters.values[c];
+    }
+    state.frame_start_counters = now;
+  }
+
+  if (state.capturing) {
+    // Mark the frame boundary across every thread's track
+    profiler_capture_write("\"name\":\"frame %llu\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":0",
+      state.capture_frame_index,
+      profiler_capture_time(platform_get_ticks()));
+    state.capture_frame_index++;
+
+    if (state.capture_frames_left > 0 && --state.capture_frames_left == 0) {
+      profiler_capture_stop();
+    }
+  }
+
+  if (state.enabled && state.report_interval > 0) {
+    f64 now = platform_get_absolute_time();
+    if (now - state.last_report_time >= state.report_interval) {
+      profiler_dump();
+      profiler_reset();
+      state.last_report_time = now;
+    }
+  }
+}
+
+b8
+profiler_capture_start(const char* path, u32 frame_count) {
+  if (!state.initialized) {
+    P_ERROR("profiler_capture_start: profiler is not initialized");
+    return FALSE;
+  }
+
+  if (state.capturing) {
+    profiler_capture_stop();
+  }
+
+  if (!platform_file_open(path, TRUE, &state.capture_file)) {
+    P_ERROR("profiler_capture_start: unable to open '%s'", path);
+    return FALSE;
+  }
+
+  state.capturing = TRUE;
+  state.capture_frames_left = frame_count;
+  state.capture_frame_index = 0;
+  state.capture_event_count = 0;
+  state.capture_start_ticks = platform_get_ticks();
+  state.capture_used = (u32)snprintf(state.capture_buffer, PROFILER_CAPTURE_BUFFER_SIZE, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  u32 thread_count = state.thread_count < PROFILER_MAX_THREADS ? state.thread_count : PROFILER_MAX_THREADS;
+  for (u32 i = 0; i < thread_count; ++i) {
+    profiler_thread* thread = platform_atomic_load_ptr((void* volatile*)&state.threads[i], PLATFORM_MEMORY_ORDER_ACQUIRE);
+    if (thread) {
+      thread->capture_named = FALSE;
+    }
+  }
+
+  P_INFO("Profiler capture started: '%s'", path);
+  return TRUE;
+}
+
+void
+profiler_capture_stop() {
+  if (!state.capturing) {
+    return;
+  }
+
+  state.capturing = FALSE;
+  profiler_capture_flush();
+  const char* footer = "\n]}\n";
+  platform_file_append(&state.capture_file, footer, strlen(footer));
+  platform_file_close(&state.capture_file);
+  P_INFO("Profiler capture finished: %llu frames, %llu events", state.capture_frame_index, state.capture_event_count);
+}
+
+b8
+profiler_capturing() {
+  return state.capturing;
+}
+
+void
+profiler_set_enabled(b8 enabled) {
+  platform_atomic_store_b8(&state.enabled, enabled && state.initialized, PLATFORM_MEMORY_ORDER_RELAXED);
+  state.last_report_time = platform_get_absolute_time();
+#if !PROFILER_ENABLED
+  if (enabled) {
+    P_WARN("profiler_set_enabled: profile zones were compiled out (PROFILER_ENABLED=0)");
+  }
+#endif
+}
+
+void
+profiler_set_report_interval(f64 seconds) {
+  state.report_interval = seconds;
+  state.last_report_time = platform_get_absolute_time();
+}
+
+void
+profiler_reset() {
+  for (u32 i = 0; i < state.zone_count; ++i) {
+    profiler_zone* zone = &state.zones[i];
+    zone->last_ticks = 0;
+    zone->min_ticks = 0xFFFFFFFFFFFFFFFFULL;
+    zone->max_ticks = 0;
+    zone->total_ticks = 0;
+    zone->frames = 0;
+    zone->calls = 0;
+    pzero_memory(zone->last_counters, sizeof(zone->last_counters));
+    pzero_memory(zone->total_counters, sizeof(zone->total_counters));
+  }
+  state.frame_count = 0;
+}
+
+// Lay the zones out depth first: each zone, then its children, then its next sibling
+static void
+profiler_build_order() {
+  u32 count = 0;
+  u32 zone = state.first_root;
+  while (zone != PROFILER_NO_ZONE) {
+    state.zones[zone].order_index = count;
+    state.order[count++] = zone;
+
+    if (state.zones[zone].first_child != PROFILER_NO_ZONE) {
+      zone = state.zones[zone].first_child;
+      continue;
+    }
+
+    // Climb until a zone with a sibling left to visit
+    while (zone != PROFILER_NO_ZONE && state.zones[zone].next_sibling == PROFILER_NO_ZONE) {
+      zone = state.zones[zone].parent;
+    }
+    if (zone != PROFILER_NO_ZONE) {
+      zone = state.zones[zone].next_sibling;
+    }
+  }
+
+  state.order_dirty = FALSE;
+}
+
+u32
+profiler_zone_count() {
+  return state.zone_count;
+}
+
+b8
+profiler_get_zone(u32 index, profiler_zone_stats* out_stats) {
+  if (index >= state.zone_count) {
+    return FALSE;
+  }
+
+  if (state.order_dirty) {
+    profiler_build_order();
+  }
+
+  profiler_zone* zone = &state.zones[state.order[index]];
+  f64 ms_per_tick = 1000.0 / state.ticks_per_second;
+
+  out_stats->name = zone->name;
+  out_stats->parent = zone->parent == PROFILER_NO_ZONE ? PROFILER_NO_PARENT : state.zones[zone->parent].order_index;
+  out_stats->depth = zone->depth;
+  out_stats->thread_index = zone->thread_index;
+  out_stats->calls = zone->calls;
+  out_stats->frames = zone->frames;
+  out_stats->last_ms = zone->last_ticks * ms_per_tick;
+  out_stats->min_ms = zone->frames ? zone->min_ticks * ms_per_tick : 0;
+  out_stats->avg_ms = zone->frames ? (f64)zone->total_ticks / zone->frames * ms_per_tick : 0;
+  out_stats->max_ms = zone->max_ticks * ms_per_tick;
+  for (u32 c = 0; c < PLATFORM_PERF_COUNTER_MAX_COUNTERS; ++c) {
+    out_stats->last_counters[c] = zone->last_counters[c];
+    out_stats->avg_counters[c] = zone->frames ? (f64)zone->total_counters[c] / zone->frames : 0;
+  }
+  return TRUE;
+}
+
+b8
+profiler_enable_counters(b8 enabled) {
+  profiler_thread* thread = current_thread;
+  if (!state.initialized || !thread || thread->index != 0) {
+    P_WARN("profiler_enable_counters: must be called on the main thread after profiler_initialize");
+    return FALSE;
+  }
+
+  if (enabled && !state.counters_enabled) {
+    if (!platform_perf_counters_open()) {
+      return FALSE;
+    }
+    // Begins already in the ring have no readings. Only zones begun from here on are counted
+    if (thread->recorded_depth > 0 || thread->depth > 0) {
+      P_WARN("profiler_enable_counters: enable counters outside of any zone for correct results");
+    }
+    thread->counters = pallocate(sizeof(platform_perf_counters) * PROFILER_RING_CAPACITY, MEMORY_TAG_APPLICATION);
+    pzero_memory(thread->counters, sizeof(platform_perf_counters) * PROFILER_RING_CAPACITY);
+    platform_perf_counters_read(&state.frame_start_counters);
+    state.counters_enabled = TRUE;
+  } else if (!enabled && state.counters_enabled) {
+    state.counters_enabled = FALSE;
+    pfree(thread->counters, sizeof(platform_perf_counters) * PROFILER_RING_CAPACITY, MEMORY_TAG_APPLICATION);
+    thread->counters = 0;
+    platform_perf_counters_close();
+  }
+
+  return TRUE;
+}
+
+b8
+profiler_get_frame_counters(platform_perf_counters* out_counters) {
+  if (!state.counters_enabled) {
+    return FALSE;
+  }
+
+  *out_counters = state.last_frame_counters;
+  return TRUE;
+}
+
+// Log per frame counter averages, with instructions per cycle when both were counted
+static void
+profiler_log_counters(i32 indent, const f64* counters) {
+  f64 cycles = counters[PLATFORM_PERF_COUNTER_CYCLES];
+  f64 instructions = counters[PLATFORM_PERF_COUNTER_INSTRUCTIONS];
+  P_INFO_UNLIMITED(" %*s  cycles %.0f, instructions %.0f (IPC %.2f), cache misses %.0f, branch misses %.0f",
+    indent, "",
+    cycles,
+    instructions,
+    cycles > 0 ? instructions / cycles : 0.0,
+    counters[PLATFORM_PERF_COUNTER_CACHE_MISSES],
+    counters[PLATFORM_PERF_COUNTER_BRANCH_MISSES]);
+}
+
+void
+profiler_forget_names() {
+  for (u32 i = 0; i < state.zone_count; ++i) {
+    state.zones[i].literal = 0;
+  }
+}
+
+void
+profiler_dump() {
+  P_INFO("CPU profile over %llu frames (per frame min / avg / max):", state.frame_count);
+
+  u32 count = profiler_zone_count();
+  for (u32 i = 0; i < count; ++i) {
+    profiler_zone_stats stats;
+    profiler_get_zone(i, &stats);
+    if (stats.frames == 0) {
+      continue;
+    }
+
+    // One line per zone. There can be far more zones than the rate limit allows per call site
+    P_INFO_UNLIMITED(" %*s%s: %.3fms / %.3fms / %.3fms, calls %llu",
+      (i32)(stats.depth * 2), "",
+      stats.name,
+      stats.min_ms,
+      stats.avg_ms,
+      stats.max_ms,
+      stats.calls);
+
+    if (state.counters_enabled && stats.thread_index == 0) {
+      profiler_log_counters((i32)(stats.depth * 2), stats.avg_counters);
+    }
+  }
+
+  if (state.counters_enabled) {
+    f64 last_frame[PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+    for (u32 c = 0; c < PLATFORM_PERF_COUNTER_MAX_COUNTERS; ++c) {
+      last_frame[c] = (f64)state.last_frame_counters.values[c];
+    }
+    P_INFO(" whole last frame:");
+    profiler_log_counters(0, last_frame);
+  }
+
+  u32 thread_count = state.thread_count < PROFILER_MAX_THREADS ? state.thread_count : PROFILER_MAX_THREADS;
+  for (u32 i = 0; i < thread_count; ++i) {
+    profiler_thread* thread = platform_atomic_load_ptr((void* volatile*)&state.threads[i], PLATFORM_MEMORY_ORDER_ACQUIRE);
+    u64 dropped = thread ? platform_atomic_load_u64(&thread->dropped, PLATFORM_MEMORY_ORDER_RELAXED) : 0;
+    if (dropped) {
+      P_WARN("profiler: %s skipped %llu zones (ring full or nested deeper than %u)", thread->name, dropped, PROFILER_MAX_DEPTH);
+    }
+  }
+}
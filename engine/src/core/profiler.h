@@ -0,0 +1,178 @@
+/**
+ * Instrumentation profiler
+ *
+ * P_PROFILE_SCOPE("name") times the rest of the enclosing block as a zone.
+ * Zones nest, and each thread records its begin/end events into its own
+ * ring buffer, so recording never takes a lock.
+ *
+ * Once per frame profiler_frame_end drains every thread's ring into a tree
+ * of zones (one root per thread) and folds the frame's time into each
+ * zone's min/avg/max, and optionally writes the frame to a trace file.
+ * Zone names must be string literals: only the pointer is recorded, and
+ * the name is copied into its zone when the ring is drained.
+*/
+#pragma once
+
+#include "defines.h"
+#include "platform/platform.h"
+
+// Set to 0 to compile every profile zone out of the engine and the game
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// Longest chain of nested zones tracked per thread. Deeper zones are not recorded
+#define PROFILER_MAX_DEPTH 32
+
+// Number of distinct zones (name + position in the tree) tracked over all threads
+#define PROFILER_MAX_ZONES 1024
+
+// Zone and thread names are truncated to this length, terminator included
+#define PROFILER_MAX_NAME_LENGTH 64
+
+// Statistics for one zone. Times are per frame, over the frames the zone ran in
+typedef struct profiler_zone_stats {
+  const char* name;
+  // Index of the parent zone. The root of each thread has no parent and uses PROFILER_NO_PARENT
+  u32 parent;
+  // 0 for a thread's root
+  u32 depth;
+  u32 thread_index;
+  // Number of times the zone was entered since the last reset
+  u64 calls;
+  // Number of frames the zone was entered in since the last reset
+  u64 frames;
+  // Time spent in the zone during the latest frame
+  f64 last_ms;
+  f64 min_ms;
+  f64 avg_ms;
+  f64 max_ms;
+  // Hardware counter deltas inside the zone, when counters are on: the latest frame, and the average per frame
+  u64 last_counters[PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+  f64 avg_counters[PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+} profiler_zone_stats;
+
+#define PROFILER_NO_PARENT 0xFFFFFFFF
+
+/*
+  Start the profiler. Zones entered before this are ignored
+  The calling thread is treated as the main thread
+*/
+b8 profiler_initialize();
+
+// Stop recording and release every thread's buffer
+void profiler_shutdown();
+
+/*
+  Name the calling thread in reports and captures. May be called before
+  the profiler is initialized. Threads are otherwise named by their id
+  @param name - name of the thread. Copied
+*/
+P_API void profiler_name_thread(const char* name);
+
+/*
+  Begin a zone on the calling thread. Prefer P_PROFILE_SCOPE
+  @param name - static name of the zone
+  @returns TRUE if the zone was recorded and must be ended with profiler_zone_end
+*/
+P_API b8 profiler_zone_begin(const char* name);
+
+// End the innermost zone begun on the calling thread
+P_API void profiler_zone_end();
+
+/*
+  Collect the events every thread recorded since the last call and update
+  the zone statistics. Called once per frame by the application
+*/
+void profiler_frame_end();
+
+/*
+  Write the next frames to a Chrome Trace Event JSON file, which can be
+  opened in chrome://tracing or ui.perfetto.dev. Each zone becomes a
+  complete event on its thread's track, and frame boundaries are marked
+  @param path - file to write. Replaced if it exists
+  @param frame_count - frames to capture. 0 captures until profiler_capture_stop
+  @returns FALSE if the file could not be opened
+*/
+P_API b8 profiler_capture_start(const char* path, u32 frame_count);
+
+// Finish the capture in progress and close its file
+P_API void profiler_capture_stop();
+
+// TRUE while a capture is in progress
+P_API b8 profiler_capturing();
+
+/*
+  Read hardware performance counters (cycles, instructions, cache and branch
+  misses) at the start and end of every zone on the main thread, and once per
+  frame. Each read is a system call, so zone timings grow while counters are on.
+  Must be called on the main thread, outside any zone
+  @param enabled - TRUE to open the counters, FALSE to close them
+  @returns FALSE if the platform has no counters available
+*/
+P_API b8 profiler_enable_counters(b8 enabled);
+
+/*
+  Counter deltas over the whole of the latest frame
+  @returns FALSE if counters are off
+*/
+P_API b8 profiler_get_frame_counters(platform_perf_counters* out_counters);
+
+// Turn recording on or off at runtime
+P_API void profiler_set_enabled(b8 enabled);
+
+/*
+  Set how often profiler_frame_end logs the zone tree
+  @param seconds - interval between reports. 0 disables the periodic report
+*/
+P_API void profiler_set_report_interval(f64 seconds);
+
+// Clear the statistics of every zone. The zones themselves are kept
+P_API void profiler_reset();
+
+// Log the zone tree with min/avg/max frame times
+P_API void profiler_dump();
+
+/*
+  Call before unloading a module that records zones, once its zones have
+  ended. Zones are matched to their names by address first, and a module
+  loaded later may reuse those addresses for different names. The zones
+  and their statistics are kept
+*/
+P_API void profiler_forget_names();
+
+// Number of zones recorded so far, thread roots included
+P_API u32 profiler_zone_count();
+
+/*
+  Read the statistics of a zone. Zones are ordered depth first, so every
+  zone comes after its parent and before its next sibling
+  @param index - zone to read, below profiler_zone_count()
+  @param out_stats - filled with the zone's statistics
+  @returns FALSE if index is out of range
+*/
+P_API b8 profiler_get_zone(u32 index, profiler_zone_stats* out_stats);
+
+// Used by P_PROFILE_SCOPE to end the zone when the scope exits
+static inline void
+profiler_scope_cleanup(b8* began) {
+  if (*began) {
+    profiler_zone_end();
+  }
+}
+
+#define P_PROFILE_CONCAT_INNER(a, b) a##b
+#define P_PROFILE_CONCAT(a, b) P_PROFILE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED == 1
+// Time the rest of the enclosing block. The empty literal makes a non-literal name a compile error
+#define P_PROFILE_SCOPE(name) \
+  b8 P_PROFILE_CONCAT(p_profile_scope_, __LINE__) __attribute__((cleanup(profiler_scope_cleanup))) = profiler_zone_begin("" name)
+
+// Time a whole function, named after it
+#define P_PROFILE_FUNCTION() \
+  b8 p_profile_function __attribute__((cleanup(profiler_scope_cleanup))) = profiler_zone_begin(__func__)
+#else
+#define P_PROFILE_SCOPE(name)
+#define P_PROFILE_FUNCTION()
+#endif
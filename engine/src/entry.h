@@ -15,18 +15,19 @@ main(void) {
     initialize_memory();
 
     // Request game instance from the application
-    game game_inst;
+    // Zeroed so any config the game leaves unset takes its default
+    game game_inst = {0};
     if (!create_game(&game_inst)) {
         P_FATAL("Could not create game");
         return -1;
     }
 
-    // Ensure that the game's function pointers exist
-    if (
+    // Ensure that the game's function pointers exist. A game module assigns them when it is loaded
+    if (!game_inst.app_config.game_module_path && (
         !game_inst.render ||
         !game_inst.update ||
         !game_inst.initialize ||
-        !game_inst.on_resize) {
+        !game_inst.on_resize)) {
         P_FATAL("The game's function pointers must be assigned");
         return -2;
     }
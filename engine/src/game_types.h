@@ -10,7 +10,9 @@ typedef struct game {
 
     b8 (*initialize)(struct game* game_inst);                         // function pointer to game's initialize function
     b8 (*update)(struct game* game_inst, f32 delta_time);             // function pointer to game's update function
-    b8 (*render)(struct game* game_inst, f32 delta_time);             // function pointer to game's render function
+    // function pointer to game's render function. alpha is how far the frame is between the last
+    // fixed update and the next one (0..1), for interpolating state. Always 1 without a fixed timestep
+    b8 (*render)(struct game* game_inst, f32 delta_time, f32 alpha);
     void (*on_resize)(struct game* game_inst, u32 width, u32 height); // function pointer to handle window resizes
 
     void* state; // game-specific state. Created and managed by the game
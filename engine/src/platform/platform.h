@@ -5,22 +5,40 @@
 // Maintain platform state in a decoupled way
 typedef struct platform_state {
   void* internal_state;
+  // Running without a window. Renderers draw to an offscreen target instead
+  b8 headless;
 } platform_state;
 
+// Environment variable that forces the headless backend when set to anything but "0"
+#define PLATFORM_HEADLESS_ENV "PEGASUS_HEADLESS"
 
+/*
+  Open the application window
+  @param headless - create no window. Also chosen when PLATFORM_HEADLESS_ENV is set.
+    The headless backend reports a resize to width x height on the first pump,
+    and quits on SIGINT or SIGTERM, so the full loop can run where there is no display
+*/
 P_API b8 platform_startup(
   platform_state* pstate,
   const char* application_name,
   i32 x,
   i32 y,
   i32 width,
-  i32 height
+  i32 height,
+  b8 headless
 );
 
 P_API void platform_shutdown(platform_state *pstate);
 
 P_API b8 platform_pump_messages(platform_state* pstate);
 
+/*
+  Block until the platform has messages to pump, so an idle application uses no CPU
+  @param timeout_ms - longest time to wait. PLATFORM_WAIT_INFINITE waits for the next message
+  @returns FALSE if timeout_ms elapsed with nothing to pump
+*/
+P_API b8 platform_wait_messages(platform_state* pstate, u64 timeout_ms);
+
 // Deal with platform memory
 void* platform_allocate(u64 size, b8 aligned);
 void platform_free(void* block, b8 aligned);
@@ -32,10 +50,293 @@ void* platform_set_memory(void* dest, i32 value, u64 size);
 void platform_console_write(const char* message, u8 color);
 void platform_console_write_error(const char* message, u8 color);
 
+// FILES //
+
+// Opaque handle to an open file
+typedef struct platform_file {
+  void* internal_data;
+} platform_file;
+
+// Open a file for reading and writing, creating it if needed.
+// truncate discards any existing contents
+P_API b8 platform_file_open(const char* path, b8 truncate, platform_file* out_file);
+P_API void platform_file_close(platform_file* file);
+
+// Current size of the file in bytes
+P_API u64 platform_file_size(platform_file* file);
+
+// Grow or shrink the file. Any mapped views must be unmapped first
+P_API b8 platform_file_resize(platform_file* file, u64 size);
+
+// Write to the end of the file
+P_API b8 platform_file_append(platform_file* file, const void* data, u64 size);
+
+// Map size bytes of the file starting at offset for reading and writing.
+// offset must be a multiple of platform_file_map_granularity. Returns 0 on failure
+P_API void* platform_file_map(platform_file* file, u64 offset, u64 size);
+P_API void platform_file_unmap(void* block, u64 size);
+
+// Write modified pages of a mapped view through to the file
+P_API void platform_file_flush_mapped(void* block, u64 size);
+
+// Alignment required for platform_file_map offsets
+P_API u64 platform_file_map_granularity();
+
+// Rename a file, replacing the destination if it exists
+P_API b8 platform_file_rename(const char* from, const char* to);
+
+// Delete a file. Returns FALSE if it did not exist or could not be removed
+P_API b8 platform_file_delete(const char* path);
+
+// Copy a file, replacing the destination if it exists
+P_API b8 platform_file_copy(const char* from, const char* to);
+
+/*
+  Read when a file was last written, for noticing changes
+  @param out_time - in the OS's own units. Only compare it with other reads of the same file
+  @returns FALSE if the file does not exist
+*/
+P_API b8 platform_file_write_time(const char* path, u64* out_time);
+
+// DYNAMIC LIBRARIES //
+
+// Opaque handle to a loaded shared library
+typedef struct platform_dynamic_library {
+  void* internal_data;
+} platform_dynamic_library;
+
+// Load a shared library (.so or .dll), resolving all of its symbols now
+P_API b8 platform_dynamic_library_load(const char* path, platform_dynamic_library* out_library);
+
+// Unload a library. Every pointer into it, to code or to data, is invalid afterwards
+P_API void platform_dynamic_library_unload(platform_dynamic_library* library);
+
+// Address of an exported function or variable, or 0 if the library has none by that name
+P_API void* platform_dynamic_library_symbol(platform_dynamic_library* library, const char* name);
+
 // Get the time
 f64 platform_get_absolute_time();
 
+// TIMER //
+
+// Where platform_get_ticks reads time from
+typedef enum platform_timer_source {
+  // The CPU time stamp counter. Only used when it is invariant, and calibrated on first use
+  PLATFORM_TIMER_SOURCE_TSC,
+  // The OS monotonic clock
+  PLATFORM_TIMER_SOURCE_OS
+} platform_timer_source;
+
+// Read a monotonic, high resolution tick counter. Only differences between
+// two reads are meaningful. Convert them with the core/clock.h helpers
+P_API u64 platform_get_ticks();
+
+// Number of ticks per second. Constant for the life of the process
+P_API u64 platform_get_tick_frequency();
+
+P_API platform_timer_source platform_get_timer_source();
+
+// Block the calling thread until roughly the given tick. The OS may wake it
+// late, so callers needing precision should wake early and spin the rest
+P_API void platform_sleep_until(u64 deadline_ticks);
+
 // Sleep on the thread for the provided ms. This blocks the main thread.
 // This should only be used for giving time back to the OS for unused update power
 // Therefore it is not exported
 void platform_sleep(u64 ms);
+
+// THREADING //
+
+// Opaque handle to an OS thread
+typedef struct platform_thread {
+  void* internal_data;
+  u64 thread_id;
+} platform_thread;
+
+// Entry point for a thread. The return value is the thread's exit code
+typedef u32 (*PFN_thread_start)(void* params);
+
+// Start a new thread running start_function(params)
+P_API b8 platform_thread_create(PFN_thread_start start_function, void* params, platform_thread* out_thread);
+
+// Block until the thread exits, then release its handle
+P_API void platform_thread_join(platform_thread* thread);
+
+// Get the id of the calling thread
+P_API u64 platform_current_thread_id();
+
+// Name the calling thread for debuggers and profilers. Linux keeps the first 15 characters
+P_API void platform_thread_set_name(const char* name);
+
+/*
+  Restrict the calling thread to a set of logical processors
+  @param cpu_mask - bit i allows logical processor i. Only the first 64 can be selected
+  @returns FALSE if the OS rejected the mask
+*/
+P_API b8 platform_thread_set_affinity(u64 cpu_mask);
+
+// Give the rest of the calling thread's time slice to another thread
+P_API void platform_thread_yield();
+
+// Number of logical processors the process may run on
+P_API u32 platform_get_processor_count();
+
+// Processors numbered this or higher are left out of the topology, since
+// affinity masks are 64 bits. On larger machines the job system only sizes
+// and pins workers for the first 64. Linux logs a warning when this happens.
+// Windows only reports the processor group the process runs in, which never exceeds 64
+#define PLATFORM_MAX_LOGICAL_PROCESSORS 64
+#define PLATFORM_MAX_NUMA_NODES 8
+
+// Layout of the processors the process may run on
+typedef struct platform_cpu_topology {
+  u32 logical_processor_count;
+  u32 physical_core_count;
+  u32 numa_node_count;
+
+  // Logical processors of each physical core, as affinity masks. More than one bit set means SMT siblings
+  u64 core_masks[PLATFORM_MAX_LOGICAL_PROCESSORS];
+  // Logical processors of each NUMA node
+  u64 numa_node_masks[PLATFORM_MAX_NUMA_NODES];
+
+  // Cache sizes in bytes, as seen from one core. 0 when the level is absent or unknown
+  u32 l1_data_cache_size;
+  u32 l1_instruction_cache_size;
+  u32 l2_cache_size;
+  u32 l3_cache_size;
+  u32 cache_line_size;
+} platform_cpu_topology;
+
+/*
+  Read the processor layout. Linux reads sysfs, falling back to cpuid for
+  caches, and Windows asks GetLogicalProcessorInformation. Only processors
+  in the process's affinity mask are counted
+  @returns FALSE if the layout could not be read
+*/
+P_API b8 platform_get_cpu_topology(platform_cpu_topology* out_topology);
+
+// Mutual exclusion lock. Not recursive
+typedef struct platform_mutex {
+  void* internal_data;
+} platform_mutex;
+
+P_API b8 platform_mutex_create(platform_mutex* out_mutex);
+P_API void platform_mutex_destroy(platform_mutex* mutex);
+P_API void platform_mutex_lock(platform_mutex* mutex);
+// Returns FALSE without blocking if another thread holds the lock
+P_API b8 platform_mutex_try_lock(platform_mutex* mutex);
+P_API void platform_mutex_unlock(platform_mutex* mutex);
+
+// Condition variable, always used together with a locked mutex
+typedef struct platform_condition {
+  void* internal_data;
+} platform_condition;
+
+P_API b8 platform_condition_create(platform_condition* out_condition);
+P_API void platform_condition_destroy(platform_condition* condition);
+
+// Wake one waiting thread
+P_API void platform_condition_signal(platform_condition* condition);
+
+// Wake every waiting thread
+P_API void platform_condition_broadcast(platform_condition* condition);
+
+// Counting semaphore
+typedef struct platform_semaphore {
+  void* internal_data;
+} platform_semaphore;
+
+P_API b8 platform_semaphore_create(u32 initial_count, platform_semaphore* out_semaphore);
+P_API void platform_semaphore_destroy(platform_semaphore* semaphore);
+
+// Increment the count, waking one waiting thread
+P_API void platform_semaphore_signal(platform_semaphore* semaphore);
+
+// Timeout value that makes waits block until signaled
+#define PLATFORM_WAIT_INFINITE 0xFFFFFFFFFFFFFFFFULL
+
+// Wait for the count to become non-zero, then decrement it.
+// A timeout of 0 polls without blocking.
+// Returns FALSE if timeout_ms elapsed first
+P_API b8 platform_semaphore_wait(platform_semaphore* semaphore, u64 timeout_ms);
+
+/*
+  Unlock mutex and wait for the condition to be signaled, then lock mutex again.
+  Wake-ups can be spurious, so always re-check the predicate in a loop
+  @param timeout_ms - longest time to wait. PLATFORM_WAIT_INFINITE never times out
+  @returns FALSE if timeout_ms elapsed first. The mutex is locked again either way
+*/
+P_API b8 platform_condition_wait(platform_condition* condition, platform_mutex* mutex, u64 timeout_ms);
+
+// FIBERS //
+
+// A stack and saved registers that threads can switch between. Fibers can be resumed on any thread
+typedef struct platform_fiber {
+  void* internal_data;
+} platform_fiber;
+
+// Entry point for a fiber. Must never return: switch to another fiber instead
+typedef void (*PFN_fiber_start)(void* params);
+
+/*
+  Let the calling thread switch to fibers. The thread's own context is
+  saved into out_fiber whenever it switches away, and resumes when
+  something switches back to it on the same thread
+*/
+P_API b8 platform_fiber_from_thread(platform_fiber* out_fiber);
+
+// Undo platform_fiber_from_thread. Call on the same thread, from its own context
+P_API void platform_fiber_to_thread(platform_fiber* fiber);
+
+/*
+  Create a fiber that will run start(params) the first time it is switched to
+  @param stack_size - bytes of stack. Rounded up to whole pages
+*/
+P_API b8 platform_fiber_create(u64 stack_size, PFN_fiber_start start, void* params, platform_fiber* out_fiber);
+
+// Release a fiber's stack. The fiber must not be running
+P_API void platform_fiber_destroy(platform_fiber* fiber);
+
+/*
+  Save the running context into from and resume to. Returns when
+  something switches back to from, possibly on another thread
+  @param from - the fiber running now
+  @param to - the fiber to run
+*/
+P_API void platform_fiber_switch(platform_fiber* from, platform_fiber* to);
+
+// PERFORMANCE COUNTERS //
+
+// Hardware counters that can be read for the calling thread
+typedef enum platform_perf_counter {
+  PLATFORM_PERF_COUNTER_CYCLES,
+  PLATFORM_PERF_COUNTER_INSTRUCTIONS,
+  PLATFORM_PERF_COUNTER_CACHE_MISSES,
+  PLATFORM_PERF_COUNTER_BRANCH_MISSES,
+
+  PLATFORM_PERF_COUNTER_MAX_COUNTERS
+} platform_perf_counter;
+
+// Running totals since the counters were opened. Only differences are meaningful
+typedef struct platform_perf_counters {
+  u64 values[PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+} platform_perf_counters;
+
+/*
+  Start counting user-mode hardware events on the calling thread. Only that
+  thread may read them. Linux only, through perf_event_open. Fails where
+  the kernel refuses (see /proc/sys/kernel/perf_event_paranoid) or the
+  CPU exposes no counters, as in many virtual machines
+  @returns TRUE if at least one counter could be opened
+*/
+P_API b8 platform_perf_counters_open();
+P_API void platform_perf_counters_close();
+
+// TRUE if the counter was opened. Counters that were not always read 0
+P_API b8 platform_perf_counter_available(platform_perf_counter counter);
+
+/*
+  Read every open counter in one call
+  @returns FALSE if no counters are open
+*/
+P_API b8 platform_perf_counters_read(platform_perf_counters* out_counters);
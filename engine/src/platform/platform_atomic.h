@@ -0,0 +1,85 @@
+/**
+ * Atomic operations
+ *
+ * Thin wrappers so engine code does not depend on a compiler's builtins.
+ * Every operation takes a memory order with the same meaning as C11's:
+ *  - RELAXED : atomic, but no ordering with other memory accesses
+ *  - ACQUIRE : later accesses cannot move before this load
+ *  - RELEASE : earlier accesses cannot move after this store
+ *  - ACQ_REL : both, for read-modify-write operations
+ *  - SEQ_CST : a single total order shared by every SEQ_CST operation
+ *
+ * Only aligned variables of the listed widths may be used.
+*/
+#pragma once
+
+#include "defines.h"
+
+#if defined(__clang__) || defined(__GNUC__)
+
+typedef enum platform_memory_order {
+  PLATFORM_MEMORY_ORDER_RELAXED = __ATOMIC_RELAXED,
+  PLATFORM_MEMORY_ORDER_ACQUIRE = __ATOMIC_ACQUIRE,
+  PLATFORM_MEMORY_ORDER_RELEASE = __ATOMIC_RELEASE,
+  PLATFORM_MEMORY_ORDER_ACQ_REL = __ATOMIC_ACQ_REL,
+  PLATFORM_MEMORY_ORDER_SEQ_CST = __ATOMIC_SEQ_CST
+} platform_memory_order;
+
+#define PLATFORM_ATOMIC_DEFINE(suffix, type)                                                                              \
+static inline type                                                                                                        \
+platform_atomic_load_##suffix(type const volatile* object, platform_memory_order order) {                                 \
+  return __atomic_load_n(object, order);                                                                                  \
+}                                                                                                                         \
+static inline void                                                                                                        \
+platform_atomic_store_##suffix(type volatile* object, type value, platform_memory_order order) {                          \
+  __atomic_store_n(object, value, order);                                                                                 \
+}                                                                                                                         \
+static inline type                                                                                                        \
+platform_atomic_exchange_##suffix(type volatile* object, type value, platform_memory_order order) {                       \
+  return __atomic_exchange_n(object, value, order);                                                                       \
+}                                                                                                                         \
+/* On failure *expected receives the current value */                                                                     \
+static inline b8                                                                                                          \
+platform_atomic_compare_exchange_##suffix(type volatile* object, type* expected, type desired, platform_memory_order order) { \
+  platform_memory_order failure_order = order == PLATFORM_MEMORY_ORDER_ACQ_REL ? PLATFORM_MEMORY_ORDER_ACQUIRE :          \
+    order == PLATFORM_MEMORY_ORDER_RELEASE ? PLATFORM_MEMORY_ORDER_RELAXED : order;                                       \
+  return __atomic_compare_exchange_n(object, expected, desired, FALSE, order, failure_order);                             \
+}
+
+#define PLATFORM_ATOMIC_DEFINE_ARITHMETIC(suffix, type)                                                                   \
+PLATFORM_ATOMIC_DEFINE(suffix, type)                                                                                      \
+/* Returns the value before the addition */                                                                               \
+static inline type                                                                                                        \
+platform_atomic_fetch_add_##suffix(type volatile* object, type value, platform_memory_order order) {                      \
+  return __atomic_fetch_add(object, value, order);                                                                        \
+}                                                                                                                         \
+static inline type                                                                                                        \
+platform_atomic_fetch_sub_##suffix(type volatile* object, type value, platform_memory_order order) {                      \
+  return __atomic_fetch_sub(object, value, order);                                                                        \
+}
+
+PLATFORM_ATOMIC_DEFINE(b8, b8)
+PLATFORM_ATOMIC_DEFINE_ARITHMETIC(u32, u32)
+PLATFORM_ATOMIC_DEFINE_ARITHMETIC(u64, u64)
+PLATFORM_ATOMIC_DEFINE_ARITHMETIC(i64, i64)
+PLATFORM_ATOMIC_DEFINE(ptr, void*)
+
+// Order surrounding memory accesses without an atomic variable
+static inline void
+platform_atomic_thread_fence(platform_memory_order order) {
+  __atomic_thread_fence(order);
+}
+
+#else
+#error "platform_atomic.h needs clang or gcc atomic builtins"
+#endif
+
+// Hint to the CPU that the thread is spinning, easing pressure on a shared core
+static inline void
+platform_cpu_pause() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#endif
+}
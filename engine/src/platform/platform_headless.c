@@ -0,0 +1,106 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_PLATFORM
+#include "platform_headless.h"
+
+#include "core/logger.h"
+#include "core/event.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+// Longest a wait sleeps before checking for a quit signal again
+#define HEADLESS_WAIT_STEP_MS 10
+
+typedef struct headless_state {
+  u16 width;
+  u16 height;
+  // The startup resize has been reported
+  b8 resized;
+} headless_state;
+
+// Set from signal handlers, so nothing else may be touched there
+static volatile sig_atomic_t quit_signaled = 0;
+
+static void (*previous_sigint)(int);
+static void (*previous_sigterm)(int);
+
+static void
+headless_on_signal(int signal_number) {
+  quit_signaled = 1;
+}
+
+b8
+platform_headless_requested(b8 headless) {
+  const char* value = getenv(PLATFORM_HEADLESS_ENV);
+  if (value && value[0] && strcmp(value, "0") != 0) {
+    return TRUE;
+  }
+  return headless;
+}
+
+b8
+platform_headless_startup(platform_state* pstate, i32 width, i32 height) {
+  headless_state* state = malloc(sizeof(headless_state));
+  state->width = (u16)width;
+  state->height = (u16)height;
+  state->resized = FALSE;
+  pstate->internal_state = state;
+  pstate->headless = TRUE;
+
+  // With no window to close, signals are the way to ask a run to stop
+  quit_signaled = 0;
+  previous_sigint = signal(SIGINT, headless_on_signal);
+  previous_sigterm = signal(SIGTERM, headless_on_signal);
+
+  P_INFO("Running headless at %ix%i", width, height);
+  return TRUE;
+}
+
+void
+platform_headless_shutdown(platform_state* pstate) {
+  signal(SIGINT, previous_sigint == SIG_ERR ? SIG_DFL : previous_sigint);
+  signal(SIGTERM, previous_sigterm == SIG_ERR ? SIG_DFL : previous_sigterm);
+
+  free(pstate->internal_state);
+  pstate->internal_state = 0;
+}
+
+b8
+platform_headless_pump_messages(platform_state* pstate) {
+  headless_state* state = (headless_state*)pstate->internal_state;
+
+  // A window reports its size once it is mapped. Do the same
+  if (!state->resized) {
+    state->resized = TRUE;
+    event_context context;
+    context.data.u16[0] = state->width;
+    context.data.u16[1] = state->height;
+    event_fire(EVENT_CODE_RESIZED, 0, context);
+  }
+
+  if (quit_signaled) {
+    P_INFO("Quit signal received");
+    event_context context = {};
+    event_fire(EVENT_CODE_APPLICATION_QUIT, 0, context);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+b8
+platform_headless_wait_messages(platform_state* pstate, u64 timeout_ms) {
+  headless_state* state = (headless_state*)pstate->internal_state;
+  if (!state->resized || quit_signaled) {
+    return TRUE;
+  }
+
+  // Signals are the only thing that can arrive. Sleep in short steps so one is noticed promptly
+  u64 waited = 0;
+  while (!quit_signaled && waited < timeout_ms) {
+    u64 step = timeout_ms - waited < HEADLESS_WAIT_STEP_MS ? timeout_ms - waited : HEADLESS_WAIT_STEP_MS;
+    platform_sleep(step);
+    waited += step;
+  }
+  return quit_signaled != 0;
+}
@@ -0,0 +1,23 @@
+/**
+ * Headless platform backend
+ *
+ * Stands in for the window on machines without a display, such as CI and
+ * render farm nodes. No window is created and no input arrives. Instead the
+ * events a window would produce are synthesized: a resize to the requested
+ * size on the first pump, so the application and renderer size themselves as
+ * usual, and a quit when the process receives SIGINT or SIGTERM.
+ *
+ * Each OS backend hands its window functions over to these when
+ * platform_state.headless is set.
+*/
+#pragma once
+
+#include "platform.h"
+
+// TRUE if the headless backend should run: asked for by the application, or forced through PLATFORM_HEADLESS_ENV
+b8 platform_headless_requested(b8 headless);
+
+b8 platform_headless_startup(platform_state* pstate, i32 width, i32 height);
+void platform_headless_shutdown(platform_state* pstate);
+b8 platform_headless_pump_messages(platform_state* pstate);
+b8 platform_headless_wait_messages(platform_state* pstate, u64 timeout_ms);
@@ -1,4 +1,8 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_PLATFORM
+// For pthread_setname_np and the CPU_SET affinity macros
+#define _GNU_SOURCE
 #include "platform.h"
+#include "platform_headless.h"
 
 
 #if P_PLATFORM_LINUX
@@ -11,6 +15,7 @@
 
 #include <xcb/xcb.h>
 #include <xcb/xproto.h>
+#include <xcb/xinput.h>
 #include <X11/keysym.h>
 #include <X11/XKBlib.h>
 #include <X11/Xlib.h>
@@ -20,6 +25,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <ucontext.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <dlfcn.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
 
 // For surface creation
 #define VK_USE_PLATFORM_XCB_KHR
@@ -34,6 +57,32 @@
 #include <unistd.h> // usleep
 #endif /* _POSIX_C_SOURCE */
 
+// Events the pump can translate before it hands them to the engine. Must be a power of 2
+#define LINUX_EVENT_RING_CAPACITY 256
+
+typedef enum linux_event_type {
+    LINUX_EVENT_KEY,
+    LINUX_EVENT_BUTTON,
+    LINUX_EVENT_MOTION,
+    LINUX_EVENT_RAW_MOTION,
+    LINUX_EVENT_RESIZE
+} linux_event_type;
+
+// An X event translated for the engine
+typedef struct linux_event {
+    linux_event_type type;
+    // X server time in milliseconds. 0 for events that carry none
+    u32 time;
+    // Keys and buttons
+    b8 pressed;
+    u16 code;
+    union {
+        struct { i16 x, y; } position;
+        struct { f32 x, y; } delta;
+        struct { u16 width, height; } size;
+    };
+} linux_event;
+
 // Linux internal state
 typedef struct internal_state {
     Display *display;
@@ -43,10 +92,38 @@ typedef struct internal_state {
     xcb_atom_t wm_protocols;
     xcb_atom_t wm_delete_win;
     VkSurfaceKHR surface;
+
+    // Last size the window was configured to, reported again when it is mapped back
+    u16 width;
+    u16 height;
+
+    // Read off the queue by platform_wait_messages, for the next pump to handle first
+    xcb_generic_event_t *pending_event;
+
+    // Engine key for each X keycode, for the current layout. 0 where there is none
+    u8 keymap[256];
+    // First event code of the XKB extension. 0 when the server has no XKB
+    u8 xkb_event_base;
+
+    // Major opcode of XInput2 events. 0 when the server has no XInput2
+    u8 xinput_opcode;
+    b8 focused;
+
+    // Translated events waiting to be dispatched. Positions only ever increase
+    linux_event events[LINUX_EVENT_RING_CAPACITY];
+    u32 event_read;
+    u32 event_write;
 } internal_state;
 
+STATIC_ASSERT(KEYS_MAX_KEYS <= 256, "The keycode table stores engine keys as u8.");
+
+static void linux_dispatch_events(internal_state *state);
+static void linux_keymap_initialize(internal_state *state);
+static void linux_keymap_build(internal_state *state);
+static void linux_xinput_initialize(internal_state *state);
 
-keys translate_key(u32 x_keycode); // translate keycode from what X defines it as to what we want to use
+
+keys translate_key(u32 x_keycode); // translate keysym from what X defines it as to what we want to use
                                    // we already use the Windows keycodes, so we are translating them to 
                                    // thos that we have already defined
 
@@ -58,18 +135,38 @@ platform_startup(
     i32 x,
     i32 y,
     i32 width,
-    i32 height) { 
+    i32 height,
+    b8 headless) { 
  
+    if (platform_headless_requested(headless)) {
+        return platform_headless_startup(pstate, width, height);
+    }
+    pstate->headless = FALSE;
+
     // Create internal state
     pstate->internal_state = malloc(sizeof(internal_state));
     internal_state *state = (internal_state *)pstate->internal_state;
 
+    state->width = (u16)width;
+    state->height = (u16)height;
+    state->pending_event = 0;
+    state->xinput_opcode = 0;
+    state->focused = FALSE;
+    state->event_read = 0;
+    state->event_write = 0;
+
     // Connect to X
     state->display = XOpenDisplay(NULL);
+    if (!state->display) {
+        P_FATAL("Unable to open the X display. Set %s=1 to run without a window", PLATFORM_HEADLESS_ENV);
+        return FALSE;
+    }
 
     // Turn off key repeats
     XAutoRepeatOff(state->display);
 
+    linux_keymap_initialize(state);
+
     // Retrieve the connection from the display
     state->connection = XGetXCBConnection(state->display);
 
@@ -103,7 +200,7 @@ platform_startup(
     u32 event_values = XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE | 
                        XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE | 
                        XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_POINTER_MOTION | 
-                       XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+                       XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_FOCUS_CHANGE;
 
     // Values to be sent to XCB
     u32 value_list[] = {state->screen->black_pixel, event_values};
@@ -171,6 +268,8 @@ platform_startup(
             32,
             &wm_delete_reply->atom);
 
+    linux_xinput_initialize(state);
+
     // map window to the screen
     xcb_map_window(state->connection, state->window);
 
@@ -184,9 +283,103 @@ platform_startup(
     return TRUE;
 }
 
+// Build the keycode table, and ask XKB to tell us when the layout or keyboard changes
+static void
+linux_keymap_initialize(internal_state *state) {
+    state->xkb_event_base = 0;
+
+    i32 opcode, event_base, error_base;
+    i32 major = XkbMajorVersion;
+    i32 minor = XkbMinorVersion;
+    if (XkbQueryExtension(state->display, &opcode, &event_base, &error_base, &major, &minor)) {
+        u32 mask = XkbNewKeyboardNotifyMask | XkbMapNotifyMask;
+        XkbSelectEvents(state->display, XkbUseCoreKbd, mask, mask);
+        state->xkb_event_base = (u8)event_base;
+    } else {
+        P_WARN("XKB extension not available. Keyboard layout changes will not be picked up");
+    }
+
+    linux_keymap_build(state);
+}
+
+// Translate every keycode once, so a key event is a single table load. Each
+// key takes the first keysym that maps to an engine key, trying every shift
+// level of a group before the next group. Letters follow the layout, non-Latin
+// layouts fall back to their Latin group, and keypad keys reach their digits
+// on the Num Lock level, as level 0 holds KP_Home, KP_End and so on
+static void
+linux_keymap_build(internal_state *state) {
+    platform_zero_memory(state->keymap, sizeof(state->keymap));
+
+    XkbDescPtr desc = XkbGetMap(state->display, XkbKeyTypesMask | XkbKeySymsMask, XkbUseCoreKbd);
+    if (!desc) {
+        P_ERROR("Unable to read the keyboard mapping");
+        return;
+    }
+
+    u32 mapped = 0;
+    for (u32 code = desc->min_key_code; code <= desc->max_key_code; ++code) {
+        u32 group_count = XkbKeyNumGroups(desc, code);
+        keys key = 0;
+        for (u32 group = 0; group < group_count && !key; ++group) {
+            u32 level_count = XkbKeyGroupWidth(desc, code, group);
+            for (u32 level = 0; level < level_count && !key; ++level) {
+                key = translate_key(XkbKeySymEntry(desc, code, level, group));
+            }
+        }
+
+        if (key) {
+            state->keymap[code] = (u8)key;
+            mapped++;
+        }
+    }
+
+    XkbFreeKeyboard(desc, 0, True);
+    P_DEBUG("Keyboard mapping built: %u keycodes mapped", mapped);
+}
+
+// Ask for XInput2 raw motion, which reports every sample of a high rate mouse
+// without pointer acceleration or clamping to the window
+static void
+linux_xinput_initialize(internal_state *state) {
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data(state->connection, &xcb_input_id);
+    if (!extension || !extension->present) {
+        P_INFO("XInput extension not available. Raw mouse motion is disabled");
+        return;
+    }
+
+    xcb_input_xi_query_version_reply_t *version = xcb_input_xi_query_version_reply(
+            state->connection,
+            xcb_input_xi_query_version(state->connection, 2, 0),
+            NULL);
+    if (!version || version->major_version < 2) {
+        P_INFO("XInput2 not available. Raw mouse motion is disabled");
+        free(version);
+        return;
+    }
+    free(version);
+
+    // Raw events can only be selected on the root window
+    struct {
+        xcb_input_event_mask_t header;
+        u32 mask;
+    } raw_mask;
+    raw_mask.header.deviceid = XCB_INPUT_DEVICE_ALL_MASTER;
+    raw_mask.header.mask_len = 1;
+    raw_mask.mask = XCB_INPUT_XI_EVENT_MASK_RAW_MOTION;
+    xcb_input_xi_select_events(state->connection, state->screen->root, 1, &raw_mask.header);
+
+    state->xinput_opcode = extension->major_opcode;
+}
+
 // Shutdown behavior when the application closes
 void 
 platform_shutdown(platform_state *pstate) {
+    if (pstate->headless) {
+        platform_headless_shutdown(pstate);
+        return;
+    }
+
     // Simply cold cast to the known type
     internal_state *state = (internal_state *)pstate->internal_state;
 
@@ -197,96 +390,267 @@ platform_shutdown(platform_state *pstate) {
 }
 
 
-b8 
-platform_pump_messages(platform_state* pstate) {
-    internal_state *state = (internal_state*)pstate->internal_state;
-
-    xcb_generic_event_t *event;
-    xcb_client_message_event_t *cm;
-
-    b8 quit_flagged = FALSE;
+// Queue an event for linux_dispatch_events, handing the queue over first if it is full
+static linux_event*
+linux_push_event(internal_state *state, linux_event_type type, u32 time) {
+    if (state->event_write - state->event_read == LINUX_EVENT_RING_CAPACITY) {
+        linux_dispatch_events(state);
+    }
 
-    // Poll the events
-    // event = xcb_poll_for_event(state->connection);
-    while (event != 0) {
-        event = xcb_poll_for_event(state->connection);
-        if (event == 0) {
-            break;
-        } 
+    linux_event *event = &state->events[state->event_write & (LINUX_EVENT_RING_CAPACITY - 1)];
+    state->event_write++;
+    event->type = type;
+    event->time = time;
+    return event;
+}
 
-        switch (event->response_type & ~0x80) {
-            case XCB_KEY_PRESS:
-            case XCB_KEY_RELEASE: {
-                // handle key presses and releases
-                xcb_key_press_event_t *kb_event = (xcb_key_press_event_t *)event;
-                b8 pressed = event->response_type == XCB_KEY_PRESS;
+// The newest queued event, if it has the given type and has not been dispatched
+static linux_event*
+linux_last_event(internal_state *state, linux_event_type type) {
+    if (state->event_write == state->event_read) {
+        return 0;
+    }
+    linux_event *event = &state->events[(state->event_write - 1) & (LINUX_EVENT_RING_CAPACITY - 1)];
+    return event->type == type ? event : 0;
+}
 
-                xcb_keycode_t code = kb_event->detail;
-                KeySym key_sym = XkbKeycodeToKeysym(state->display, (KeyCode)code, 0, code & ShiftMask ? 1 : 0);
+// Add up the x and y axes of an XInput2 raw motion event. These are the
+// device's own counts, before pointer acceleration
+static void
+linux_raw_motion_delta(xcb_input_raw_motion_event_t *raw, f32 *out_dx, f32 *out_dy) {
+    *out_dx = 0;
+    *out_dy = 0;
+    if (xcb_input_raw_button_press_valuator_mask_length(raw) < 1) {
+        return;
+    }
 
-                keys key = translate_key(key_sym);
+    // Values are only sent for the axes set in the mask, lowest axis first
+    u32 mask = xcb_input_raw_button_press_valuator_mask(raw)[0];
+    xcb_input_fp3232_t *values = xcb_input_raw_button_press_axisvalues_raw(raw);
+    u32 value_index = 0;
+    if (mask & 1) {
+        *out_dx = (f32)(values[value_index].integral + values[value_index].frac / 4294967296.0);
+        value_index++;
+    }
+    if (mask & 2) {
+        *out_dy = (f32)(values[value_index].integral + values[value_index].frac / 4294967296.0);
+    }
+}
 
-                // Pass to input subsystem
-                input_process_key(key, pressed);
-            } break;
-            case XCB_BUTTON_PRESS:
-            case XCB_BUTTON_RELEASE: {
-                // mouse button presses and releases
-                xcb_button_press_event_t *mouse_event = (xcb_button_press_event_t*)event;
-                b8 pressed = event->response_type == XCB_BUTTON_PRESS;
-                buttons mouse_button = BUTTON_MAX_BUTTONS;
-                switch (mouse_event->detail) {
-                    case XCB_BUTTON_INDEX_1:
-                        mouse_button = BUTTON_LEFT;
-                        break;
-                    case XCB_BUTTON_INDEX_2:
-                        mouse_button = BUTTON_MIDDLE;
-                        break;
-                    case XCB_BUTTON_INDEX_3:
-                        mouse_button = BUTTON_RIGHT;
-                        break;
-                }
+// Turn one XCB event into queued engine events. Returns TRUE if it asks the application to quit
+static b8
+linux_translate_event(internal_state *state, xcb_generic_event_t *event) {
+    u8 type = event->response_type & ~0x80;
+    switch (type) {
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE: {
+            // handle key presses and releases
+            xcb_key_press_event_t *kb_event = (xcb_key_press_event_t *)event;
+
+            u8 key = state->keymap[kb_event->detail];
+            if (key) {
+                linux_event *queued = linux_push_event(state, LINUX_EVENT_KEY, kb_event->time);
+                queued->pressed = type == XCB_KEY_PRESS;
+                queued->code = key;
+            }
+        } break;
+        case XCB_MAPPING_NOTIFY: {
+            // Keyboard mapping changed, for servers without XKB
+            xcb_mapping_notify_event_t *mapping_event = (xcb_mapping_notify_event_t *)event;
+            if (mapping_event->request == XCB_MAPPING_KEYBOARD) {
+                linux_keymap_build(state);
+            }
+        } break;
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE: {
+            // mouse button presses and releases
+            xcb_button_press_event_t *mouse_event = (xcb_button_press_event_t*)event;
+            buttons mouse_button = BUTTON_MAX_BUTTONS;
+            switch (mouse_event->detail) {
+                case XCB_BUTTON_INDEX_1:
+                    mouse_button = BUTTON_LEFT;
+                    break;
+                case XCB_BUTTON_INDEX_2:
+                    mouse_button = BUTTON_MIDDLE;
+                    break;
+                case XCB_BUTTON_INDEX_3:
+                    mouse_button = BUTTON_RIGHT;
+                    break;
+            }
 
-                // Pass to the input subsystem
-                if (mouse_button != BUTTON_MAX_BUTTONS) {
-                    input_process_button(mouse_button, pressed);
-                }
+            if (mouse_button != BUTTON_MAX_BUTTONS) {
+                linux_event *queued = linux_push_event(state, LINUX_EVENT_BUTTON, mouse_event->time);
+                queued->pressed = type == XCB_BUTTON_PRESS;
+                queued->code = mouse_button;
+            }
+        } break;
+        case XCB_MOTION_NOTIFY: {
+            // mouse movement. Only the latest position of a run of moves matters
+            xcb_motion_notify_event_t *mouse_event = (xcb_motion_notify_event_t *)event;
+            linux_event *queued = linux_last_event(state, LINUX_EVENT_MOTION);
+            if (!queued) {
+                queued = linux_push_event(state, LINUX_EVENT_MOTION, mouse_event->time);
+            }
+            queued->time = mouse_event->time;
+            queued->position.x = mouse_event->event_x;
+            queued->position.y = mouse_event->event_y;
+        } break;
+        case XCB_GE_GENERIC: {
+            // XInput2 raw motion. Consecutive samples are summed into one event
+            xcb_ge_generic_event_t *generic = (xcb_ge_generic_event_t *)event;
+            if (generic->extension != state->xinput_opcode || generic->event_type != XCB_INPUT_RAW_MOTION || !state->focused) {
+                break;
             }
-            case XCB_MOTION_NOTIFY: {
-                // mouse movement
-                xcb_motion_notify_event_t *mouse_event = (xcb_motion_notify_event_t *)event;
 
-                // Pass to the input subsystem
-                input_process_mouse_move(mouse_event->event_x, mouse_event->event_y);
+            xcb_input_raw_motion_event_t *raw = (xcb_input_raw_motion_event_t *)event;
+            f32 dx, dy;
+            linux_raw_motion_delta(raw, &dx, &dy);
+            linux_event *queued = linux_last_event(state, LINUX_EVENT_RAW_MOTION);
+            if (!queued) {
+                queued = linux_push_event(state, LINUX_EVENT_RAW_MOTION, raw->time);
+                queued->delta.x = 0;
+                queued->delta.y = 0;
+            }
+            queued->time = raw->time;
+            queued->delta.x += dx;
+            queued->delta.y += dy;
+        } break;
+        case XCB_CONFIGURE_NOTIFY: {
+            //  Resizing
+            xcb_configure_notify_event_t *configure_event = (xcb_configure_notify_event_t*)event;
+            state->width = configure_event->width;
+            state->height = configure_event->height;
+            linux_event *queued = linux_push_event(state, LINUX_EVENT_RESIZE, 0);
+            queued->size.width = configure_event->width;
+            queued->size.height = configure_event->height;
+        } break;
+        case XCB_UNMAP_NOTIFY:
+        case XCB_MAP_NOTIFY: {
+            // X keeps a minimized window's size, so report it as 0x0 while it is
+            // unmapped. The application suspends until it is mapped back
+            b8 mapped = type == XCB_MAP_NOTIFY;
+            linux_event *queued = linux_push_event(state, LINUX_EVENT_RESIZE, 0);
+            queued->size.width = mapped ? state->width : 0;
+            queued->size.height = mapped ? state->height : 0;
+        } break;
+        case XCB_FOCUS_IN:
+        case XCB_FOCUS_OUT: {
+            // Raw motion is reported wherever the pointer is, so only take it while focused
+            state->focused = type == XCB_FOCUS_IN;
+        } break;
+        case XCB_CLIENT_MESSAGE: {
+            xcb_client_message_event_t *cm = (xcb_client_message_event_t*)event;
+
+            // Window close
+            if (cm->data.data32[0] == state->wm_delete_win) {
+                P_INFO("Window close requested");
+                return TRUE;
+            }
+        } break;
+        default:
+            // XKB sends all of its events under one code, with the kind in the second byte
+            if (state->xkb_event_base && type == state->xkb_event_base &&
+                (event->pad0 == XkbNewKeyboardNotify || event->pad0 == XkbMapNotify)) {
+                linux_keymap_build(state);
             }
-            case XCB_CONFIGURE_NOTIFY: {
-                //  Resizing
-                xcb_configure_notify_event_t *configure_event = (xcb_configure_notify_t*)event;
+            break;
+    }
+
+    return FALSE;
+}
+
+// Hand every queued event to the engine, oldest first
+static void
+linux_dispatch_events(internal_state *state) {
+    while (state->event_read != state->event_write) {
+        linux_event *event = &state->events[state->event_read & (LINUX_EVENT_RING_CAPACITY - 1)];
+        switch (event->type) {
+            case LINUX_EVENT_KEY:
+                input_process_key((keys)event->code, event->pressed, event->time);
+                break;
+            case LINUX_EVENT_BUTTON:
+                input_process_button((buttons)event->code, event->pressed, event->time);
+                break;
+            case LINUX_EVENT_MOTION:
+                input_process_mouse_move(event->position.x, event->position.y, event->time);
+                break;
+            case LINUX_EVENT_RAW_MOTION:
+                input_process_mouse_raw_move(event->delta.x, event->delta.y);
+                break;
+            case LINUX_EVENT_RESIZE: {
                 event_context context;
-                context.data.u16[0] = configure_event->width;
-                context.data.u16[1] = configure_event->height;
+                context.data.u16[0] = event->size.width;
+                context.data.u16[1] = event->size.height;
                 event_fire(EVENT_CODE_RESIZED, NULL, context);
             } break;
-            case XCB_CLIENT_MESSAGE: {
-                cm = (xcb_client_message_event_t*)event;
-                
-                P_INFO("Should be destroying window");
-                // Window close
-                if (cm->data.data32[0] == state->wm_delete_win) {
-                    quit_flagged = TRUE;
-                }
-            } break;
-            default:
-                // someting else
-                break;
         }
+        state->event_read++;
+    }
+}
+
+b8 
+platform_pump_messages(platform_state* pstate) {
+    if (pstate->headless) {
+        return platform_headless_pump_messages(pstate);
+    }
 
+    internal_state *state = (internal_state*)pstate->internal_state;
+    b8 quit_flagged = FALSE;
+
+    // An event read ahead by platform_wait_messages goes first
+    if (state->pending_event) {
+        quit_flagged |= linux_translate_event(state, state->pending_event);
+        free(state->pending_event);
+        state->pending_event = 0;
+    }
+
+    // Read from the socket once, then drain what that brought in without
+    // going back to it for every event
+    xcb_generic_event_t *event = xcb_poll_for_event(state->connection);
+    while (event) {
+        quit_flagged |= linux_translate_event(state, event);
         free(event);
+        event = xcb_poll_for_queued_event(state->connection);
     }
 
+    linux_dispatch_events(state);
     return !quit_flagged;
 }
 
+b8
+platform_wait_messages(platform_state* pstate, u64 timeout_ms) {
+    if (pstate->headless) {
+        return platform_headless_wait_messages(pstate, timeout_ms);
+    }
+
+    internal_state *state = (internal_state*)pstate->internal_state;
+    if (state->pending_event) {
+        return TRUE;
+    }
+
+    // Anything still buffered on our side may be what the server has to answer
+    xcb_flush(state->connection);
+
+    // Events XCB already read off the socket will not wake poll
+    state->pending_event = xcb_poll_for_queued_event(state->connection);
+    if (state->pending_event) {
+        return TRUE;
+    }
+
+    struct pollfd descriptor;
+    descriptor.fd = xcb_get_file_descriptor(state->connection);
+    descriptor.events = POLLIN;
+    descriptor.revents = 0;
+    i32 timeout = timeout_ms == PLATFORM_WAIT_INFINITE ? -1 : timeout_ms > 0x7FFFFFFF ? 0x7FFFFFFF : (i32)timeout_ms;
+
+    i32 result;
+    do {
+        result = poll(&descriptor, 1, timeout);
+    } while (result < 0 && errno == EINTR);
+
+    return result > 0;
+}
+
 // Deal with platform memory
 void* platform_allocate(u64 size, b8 aligned) { 
     return malloc(size);
@@ -334,6 +698,206 @@ platform_console_write_error(const char* message, u8 color) {
     printf("\033[%sm%s\033[0m", color_strings[color], message);
 }
 
+// FILES //
+
+b8
+platform_file_open(const char* path, b8 truncate, platform_file* out_file) {
+    // O_APPEND keeps plain writes at the end of the file even when the size
+    // was changed by hand for mapping
+    i32 flags = O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC;
+    if (truncate) {
+        flags |= O_TRUNC;
+    }
+
+    i32 fd = open(path, flags, 0644);
+    if (fd < 0) {
+        P_ERROR("Unable to open file '%s': %s", path, strerror(errno));
+        return FALSE;
+    }
+
+    i32* handle = malloc(sizeof(i32));
+    *handle = fd;
+    out_file->internal_data = handle;
+    return TRUE;
+}
+
+static i32
+linux_file_descriptor(platform_file* file) {
+    return *(i32*)file->internal_data;
+}
+
+void
+platform_file_close(platform_file* file) {
+    if (!file || !file->internal_data) {
+        return;
+    }
+
+    close(linux_file_descriptor(file));
+    free(file->internal_data);
+    file->internal_data = 0;
+}
+
+u64
+platform_file_size(platform_file* file) {
+    struct stat file_stat;
+    if (fstat(linux_file_descriptor(file), &file_stat) != 0) {
+        return 0;
+    }
+    return (u64)file_stat.st_size;
+}
+
+b8
+platform_file_resize(platform_file* file, u64 size) {
+    return ftruncate(linux_file_descriptor(file), (off_t)size) == 0;
+}
+
+b8
+platform_file_append(platform_file* file, const void* data, u64 size) {
+    const u8* bytes = (const u8*)data;
+    while (size > 0) {
+        ssize_t written = write(linux_file_descriptor(file), bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return FALSE;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return TRUE;
+}
+
+void*
+platform_file_map(platform_file* file, u64 offset, u64 size) {
+    void* block = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, linux_file_descriptor(file), (off_t)offset);
+    if (block == MAP_FAILED) {
+        return 0;
+    }
+    return block;
+}
+
+void
+platform_file_unmap(void* block, u64 size) {
+    munmap(block, size);
+}
+
+void
+platform_file_flush_mapped(void* block, u64 size) {
+    msync(block, size, MS_SYNC);
+}
+
+u64
+platform_file_map_granularity() {
+    return (u64)sysconf(_SC_PAGESIZE);
+}
+
+b8
+platform_file_rename(const char* from, const char* to) {
+    return rename(from, to) == 0;
+}
+
+b8
+platform_file_delete(const char* path) {
+    return unlink(path) == 0;
+}
+
+b8
+platform_file_copy(const char* from, const char* to) {
+    i32 source = open(from, O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
+        P_ERROR("Unable to open file '%s': %s", from, strerror(errno));
+        return FALSE;
+    }
+
+    struct stat source_stat;
+    fstat(source, &source_stat);
+    i32 destination = open(to, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, source_stat.st_mode & 0777);
+    if (destination < 0) {
+        P_ERROR("Unable to create file '%s': %s", to, strerror(errno));
+        close(source);
+        return FALSE;
+    }
+
+    b8 success = TRUE;
+    u8 buffer[64 * 1024];
+    for (;;) {
+        ssize_t count = read(source, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            success = count == 0;
+            break;
+        }
+
+        u8* bytes = buffer;
+        while (count > 0) {
+            ssize_t written = write(destination, bytes, count);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            bytes += written;
+            count -= written;
+        }
+        if (count > 0) {
+            success = FALSE;
+            break;
+        }
+    }
+
+    close(source);
+    close(destination);
+    if (!success) {
+        P_ERROR("Failed to copy '%s' to '%s': %s", from, to, strerror(errno));
+        unlink(to);
+    }
+    return success;
+}
+
+b8
+platform_file_write_time(const char* path, u64* out_time) {
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0) {
+        return FALSE;
+    }
+    *out_time = (u64)file_stat.st_mtim.tv_sec * 1000000000ULL + (u64)file_stat.st_mtim.tv_nsec;
+    return TRUE;
+}
+
+// DYNAMIC LIBRARIES //
+
+b8
+platform_dynamic_library_load(const char* path, platform_dynamic_library* out_library) {
+    // RTLD_LOCAL keeps the library's symbols from satisfying later loads, such as the next version of itself
+    void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        P_ERROR("Unable to load library '%s': %s", path, dlerror());
+        return FALSE;
+    }
+
+    out_library->internal_data = handle;
+    return TRUE;
+}
+
+void
+platform_dynamic_library_unload(platform_dynamic_library* library) {
+    if (!library || !library->internal_data) {
+        return;
+    }
+
+    dlclose(library->internal_data);
+    library->internal_data = 0;
+}
+
+void*
+platform_dynamic_library_symbol(platform_dynamic_library* library, const char* name) {
+    return dlsym(library->internal_data, name);
+}
+
 // Get the time
 f64 
 platform_get_absolute_time() {  
@@ -343,6 +907,137 @@ platform_get_absolute_time() {
     return now.tv_sec + now.tv_nsec * 0.000000001;
 }
 
+// TIMER //
+
+// How long the TSC is measured against CLOCK_MONOTONIC_RAW on first use
+#define TIMER_CALIBRATION_NS 10000000ULL
+
+typedef struct linux_timer_state {
+    platform_timer_source source;
+    u64 frequency;
+} linux_timer_state;
+
+static linux_timer_state timer_state;
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+
+static u64
+linux_raw_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (u64)now.tv_sec * 1000000000ULL + (u64)now.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// The TSC is only a clock if it ticks at a constant rate in every power state,
+// and the kernel has not rejected it after seeing it drift between cores
+static b8
+linux_tsc_usable() {
+    u32 eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return FALSE;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    if (!(edx & (1 << 8))) {
+        return FALSE;
+    }
+
+    FILE* clocksource = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+    if (clocksource) {
+        char name[32] = {0};
+        b8 is_tsc = fgets(name, sizeof(name), clocksource) && strncmp(name, "tsc", 3) == 0;
+        fclose(clocksource);
+        return is_tsc;
+    }
+
+    return TRUE;
+}
+
+// Read both clocks as close together as possible. The TSC read is centered on
+// the clock read, keeping the tightest of a few tries so an interrupt or a
+// slow first call cannot skew the calibration
+static void
+linux_timer_sample(u64* out_ns, u64* out_tsc) {
+    u64 best_spread = 0xFFFFFFFFFFFFFFFFULL;
+    for (u32 i = 0; i < 8; ++i) {
+        u64 before = __builtin_ia32_rdtsc();
+        u64 ns = linux_raw_ns();
+        u64 after = __builtin_ia32_rdtsc();
+        if (after - before < best_spread) {
+            best_spread = after - before;
+            *out_ns = ns;
+            *out_tsc = before + (after - before) / 2;
+        }
+    }
+}
+#endif
+
+static void
+linux_timer_initialize() {
+    timer_state.source = PLATFORM_TIMER_SOURCE_OS;
+    timer_state.frequency = 1000000000ULL;
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (!linux_tsc_usable()) {
+        return;
+    }
+
+    u64 start_ns, start_tsc, end_ns, end_tsc;
+    linux_timer_sample(&start_ns, &start_tsc);
+    do {
+        linux_timer_sample(&end_ns, &end_tsc);
+    } while (end_ns - start_ns < TIMER_CALIBRATION_NS);
+
+    timer_state.frequency = (end_tsc - start_tsc) * 1000000000ULL / (end_ns - start_ns);
+    timer_state.source = PLATFORM_TIMER_SOURCE_TSC;
+#endif
+}
+
+u64
+platform_get_ticks() {
+    pthread_once(&timer_once, linux_timer_initialize);
+#if defined(__x86_64__) || defined(__i386__)
+    if (timer_state.source == PLATFORM_TIMER_SOURCE_TSC) {
+        return __builtin_ia32_rdtsc();
+    }
+#endif
+    return linux_raw_ns();
+}
+
+u64
+platform_get_tick_frequency() {
+    pthread_once(&timer_once, linux_timer_initialize);
+    return timer_state.frequency;
+}
+
+platform_timer_source
+platform_get_timer_source() {
+    pthread_once(&timer_once, linux_timer_initialize);
+    return timer_state.source;
+}
+
+void
+platform_sleep_until(u64 deadline_ticks) {
+    u64 now_ticks = platform_get_ticks();
+    if (deadline_ticks <= now_ticks) {
+        return;
+    }
+
+    // clock_nanosleep wants a CLOCK_MONOTONIC time, so move the deadline onto that clock
+    u64 frequency = platform_get_tick_frequency();
+    u64 remaining_ticks = deadline_ticks - now_ticks;
+    u64 remaining_ns = (remaining_ticks / frequency) * 1000000000ULL + (remaining_ticks % frequency) * 1000000000ULL / frequency;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    u64 deadline_ns = (u64)deadline.tv_sec * 1000000000ULL + (u64)deadline.tv_nsec + remaining_ns;
+    deadline.tv_sec = deadline_ns / 1000000000ULL;
+    deadline.tv_nsec = deadline_ns % 1000000000ULL;
+
+    // An absolute deadline survives being interrupted by a signal without drifting
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, 0) == EINTR) {
+    }
+}
+
 // Sleep on the thread for the provided ms. This blocks the main thread.
 // This should only be used for giving time back to the OS for unused update power
 // Therefore it is not exported
@@ -361,6 +1056,688 @@ platform_sleep(u64 ms) {
     #endif
 }
 
+// THREADING //
+
+typedef struct linux_thread_start {
+    PFN_thread_start start_function;
+    void* params;
+} linux_thread_start;
+
+// pthreads expects void*(*)(void*), so hop through this to call the engine signature
+static void*
+linux_thread_trampoline(void* arg) {
+    linux_thread_start start = *(linux_thread_start*)arg;
+    free(arg);
+
+    u32 result = start.start_function(start.params);
+    return (void*)(u64)result;
+}
+
+b8
+platform_thread_create(PFN_thread_start start_function, void* params, platform_thread* out_thread) {
+    if (!start_function || !out_thread) {
+        return FALSE;
+    }
+
+    linux_thread_start* start = malloc(sizeof(linux_thread_start));
+    start->start_function = start_function;
+    start->params = params;
+
+    pthread_t* handle = malloc(sizeof(pthread_t));
+    i32 result = pthread_create(handle, NULL, linux_thread_trampoline, start);
+    if (result != 0) {
+        P_ERROR("pthread_create failed: %s", strerror(result));
+        free(start);
+        free(handle);
+        return FALSE;
+    }
+
+    out_thread->internal_data = handle;
+    out_thread->thread_id = (u64)*handle;
+    return TRUE;
+}
+
+void
+platform_thread_join(platform_thread* thread) {
+    if (!thread || !thread->internal_data) {
+        return;
+    }
+
+    pthread_t* handle = (pthread_t*)thread->internal_data;
+    pthread_join(*handle, NULL);
+    free(handle);
+    thread->internal_data = 0;
+    thread->thread_id = 0;
+}
+
+u64
+platform_current_thread_id() {
+    return (u64)pthread_self();
+}
+
+void
+platform_thread_set_name(const char* name) {
+    // The kernel limit is 16 bytes including the terminator
+    char short_name[16];
+    strncpy(short_name, name, sizeof(short_name) - 1);
+    short_name[sizeof(short_name) - 1] = 0;
+    pthread_setname_np(pthread_self(), short_name);
+}
+
+b8
+platform_thread_set_affinity(u64 cpu_mask) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (u32 i = 0; i < 64; ++i) {
+        if (cpu_mask & (1ULL << i)) {
+            CPU_SET(i, &set);
+        }
+    }
+
+    i32 result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        P_WARN("pthread_setaffinity_np failed: %s", strerror(result));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void
+platform_thread_yield() {
+    sched_yield();
+}
+
+u32
+platform_get_processor_count() {
+    // Respect taskset and cgroup cpusets rather than counting every CPU in the machine
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        i32 count = CPU_COUNT(&set);
+        if (count > 0) {
+            return (u32)count;
+        }
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (u32)online : 1;
+}
+
+// Read the first line of a sysfs file, without its newline
+static b8
+linux_read_sysfs(const char* path, char* buffer, u32 size) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return FALSE;
+    }
+
+    b8 read = fgets(buffer, size, file) != 0;
+    fclose(file);
+    if (read) {
+        buffer[strcspn(buffer, "\n")] = 0;
+    }
+    return read;
+}
+
+// Parse a sysfs cpu list such as "0-3,8,10-11" into a mask of the first 64 processors
+static u64
+linux_parse_cpu_list(const char* list) {
+    u64 mask = 0;
+    const char* cursor = list;
+    while (*cursor) {
+        char* end;
+        unsigned long first = strtoul(cursor, &end, 10);
+        if (end == cursor) {
+            break;
+        }
+        unsigned long last = first;
+        cursor = end;
+        if (*cursor == '-') {
+            last = strtoul(cursor + 1, &end, 10);
+            cursor = end;
+        }
+        for (unsigned long cpu = first; cpu <= last && cpu < PLATFORM_MAX_LOGICAL_PROCESSORS; ++cpu) {
+            mask |= 1ULL << cpu;
+        }
+        if (*cursor == ',') {
+            cursor++;
+        }
+    }
+    return mask;
+}
+
+static void
+linux_set_cache_size(platform_cpu_topology* topology, u32 level, const char* type, u32 size) {
+    if (level == 1 && strcmp(type, "Data") == 0) {
+        topology->l1_data_cache_size = size;
+    } else if (level == 1 && strcmp(type, "Instruction") == 0) {
+        topology->l1_instruction_cache_size = size;
+    } else if (level == 2) {
+        topology->l2_cache_size = size;
+    } else if (level == 3) {
+        topology->l3_cache_size = size;
+    }
+}
+
+// Cache parameters straight from the CPU, for kernels that do not expose them in sysfs
+static void
+linux_cpuid_caches(platform_cpu_topology* topology) {
+#if defined(__x86_64__) || defined(__i386__)
+    u32 eax, ebx, ecx, edx;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) {
+        return;
+    }
+
+    // Intel reports caches on leaf 4. AMD uses the same layout on leaf 0x8000001D
+    u32 leaf = 4;
+    if (ebx == 0x68747541) { // "Auth"enticAMD
+        leaf = 0x8000001D;
+        __get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    }
+    if (eax < leaf) {
+        return;
+    }
+
+    static const char* types[4] = { "", "Data", "Instruction", "Unified" };
+    for (u32 index = 0; index < 8; ++index) {
+        __cpuid_count(leaf, index, eax, ebx, ecx, edx);
+        u32 type = eax & 0x1F;
+        if (type == 0 || type > 3) {
+            break;
+        }
+
+        u32 level = (eax >> 5) & 0x7;
+        u32 line_size = (ebx & 0xFFF) + 1;
+        u32 partitions = ((ebx >> 12) & 0x3FF) + 1;
+        u32 ways = ((ebx >> 22) & 0x3FF) + 1;
+        u32 sets = ecx + 1;
+        linux_set_cache_size(topology, level, types[type], ways * partitions * line_size * sets);
+        if (level == 1) {
+            topology->cache_line_size = line_size;
+        }
+    }
+#endif
+}
+
+b8
+platform_get_cpu_topology(platform_cpu_topology* out_topology) {
+    memset(out_topology, 0, sizeof(platform_cpu_topology));
+
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return FALSE;
+    }
+
+    char path[128];
+    char line[256];
+    u64 allowed = 0;
+    u64 assigned = 0;
+    for (u32 cpu = 0; cpu < PLATFORM_MAX_LOGICAL_PROCESSORS; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            allowed |= 1ULL << cpu;
+        }
+    }
+
+    // Numbered past what a mask can hold. These get no workers and no pinning
+    u32 dropped = (u32)CPU_COUNT(&set) - (u32)__builtin_popcountll(allowed);
+    if (dropped > 0) {
+        P_WARN("%u logical processors are numbered %u or higher and are left out of the CPU topology",
+            dropped, PLATFORM_MAX_LOGICAL_PROCESSORS);
+    }
+
+    for (u32 cpu = 0; cpu < PLATFORM_MAX_LOGICAL_PROCESSORS; ++cpu) {
+        u64 bit = 1ULL << cpu;
+        if (!(allowed & bit)) {
+            continue;
+        }
+        out_topology->logical_processor_count++;
+        if (assigned & bit) {
+            continue;
+        }
+
+        // Each processor lists the SMT siblings sharing its core, itself included
+        u64 siblings = 0;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+        if (linux_read_sysfs(path, line, sizeof(line))) {
+            siblings = linux_parse_cpu_list(line) & allowed;
+        }
+        siblings |= bit;
+
+        out_topology->core_masks[out_topology->physical_core_count++] = siblings;
+        assigned |= siblings;
+    }
+
+    for (u32 node = 0; node < 64 && out_topology->numa_node_count < PLATFORM_MAX_NUMA_NODES; ++node) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+        if (!linux_read_sysfs(path, line, sizeof(line))) {
+            continue;
+        }
+        u64 mask = linux_parse_cpu_list(line) & allowed;
+        if (mask) {
+            out_topology->numa_node_masks[out_topology->numa_node_count++] = mask;
+        }
+    }
+    if (out_topology->numa_node_count == 0) {
+        // Kernels without NUMA support have no node directory
+        out_topology->numa_node_masks[0] = allowed;
+        out_topology->numa_node_count = 1;
+    }
+
+    // Caches of the first processor the process may use
+    u32 first_cpu = 0;
+    while (first_cpu < PLATFORM_MAX_LOGICAL_PROCESSORS - 1 && !(allowed & (1ULL << first_cpu))) {
+        first_cpu++;
+    }
+    b8 found_cache = FALSE;
+    for (u32 index = 0; index < 8; ++index) {
+        char type[32];
+        char size[32];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/level", first_cpu, index);
+        if (!linux_read_sysfs(path, line, sizeof(line))) {
+            break;
+        }
+        u32 level = (u32)strtoul(line, 0, 10);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/type", first_cpu, index);
+        if (!linux_read_sysfs(path, type, sizeof(type))) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/size", first_cpu, index);
+        if (!linux_read_sysfs(path, size, sizeof(size))) {
+            continue;
+        }
+
+        // Sizes read like "32K" or "8M"
+        char* unit;
+        u32 bytes = (u32)strtoul(size, &unit, 10);
+        bytes *= *unit == 'K' ? 1024 : *unit == 'M' ? 1024 * 1024 : 1;
+        linux_set_cache_size(out_topology, level, type, bytes);
+        found_cache = TRUE;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/coherency_line_size", first_cpu, index);
+        if (level == 1 && linux_read_sysfs(path, line, sizeof(line))) {
+            out_topology->cache_line_size = (u32)strtoul(line, 0, 10);
+        }
+    }
+    if (!found_cache) {
+        linux_cpuid_caches(out_topology);
+    }
+    if (out_topology->cache_line_size == 0) {
+        out_topology->cache_line_size = 64;
+    }
+
+    return out_topology->logical_processor_count > 0;
+}
+
+b8
+platform_mutex_create(platform_mutex* out_mutex) {
+    pthread_mutex_t* handle = malloc(sizeof(pthread_mutex_t));
+    i32 result = pthread_mutex_init(handle, NULL);
+    if (result != 0) {
+        P_ERROR("pthread_mutex_init failed: %s", strerror(result));
+        free(handle);
+        return FALSE;
+    }
+
+    out_mutex->internal_data = handle;
+    return TRUE;
+}
+
+void
+platform_mutex_destroy(platform_mutex* mutex) {
+    if (!mutex || !mutex->internal_data) {
+        return;
+    }
+
+    pthread_mutex_destroy((pthread_mutex_t*)mutex->internal_data);
+    free(mutex->internal_data);
+    mutex->internal_data = 0;
+}
+
+void
+platform_mutex_lock(platform_mutex* mutex) {
+    pthread_mutex_lock((pthread_mutex_t*)mutex->internal_data);
+}
+
+b8
+platform_mutex_try_lock(platform_mutex* mutex) {
+    return pthread_mutex_trylock((pthread_mutex_t*)mutex->internal_data) == 0;
+}
+
+void
+platform_mutex_unlock(platform_mutex* mutex) {
+    pthread_mutex_unlock((pthread_mutex_t*)mutex->internal_data);
+}
+
+b8
+platform_condition_create(platform_condition* out_condition) {
+    // Time out against the monotonic clock so wall clock changes do not stretch waits
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+
+    pthread_cond_t* handle = malloc(sizeof(pthread_cond_t));
+    i32 result = pthread_cond_init(handle, &attributes);
+    pthread_condattr_destroy(&attributes);
+    if (result != 0) {
+        P_ERROR("pthread_cond_init failed: %s", strerror(result));
+        free(handle);
+        return FALSE;
+    }
+
+    out_condition->internal_data = handle;
+    return TRUE;
+}
+
+void
+platform_condition_destroy(platform_condition* condition) {
+    if (!condition || !condition->internal_data) {
+        return;
+    }
+
+    pthread_cond_destroy((pthread_cond_t*)condition->internal_data);
+    free(condition->internal_data);
+    condition->internal_data = 0;
+}
+
+void
+platform_condition_signal(platform_condition* condition) {
+    pthread_cond_signal((pthread_cond_t*)condition->internal_data);
+}
+
+void
+platform_condition_broadcast(platform_condition* condition) {
+    pthread_cond_broadcast((pthread_cond_t*)condition->internal_data);
+}
+
+b8
+platform_semaphore_create(u32 initial_count, platform_semaphore* out_semaphore) {
+    sem_t* handle = malloc(sizeof(sem_t));
+    if (sem_init(handle, 0, initial_count) != 0) {
+        P_ERROR("sem_init failed: %s", strerror(errno));
+        free(handle);
+        return FALSE;
+    }
+
+    out_semaphore->internal_data = handle;
+    return TRUE;
+}
+
+void
+platform_semaphore_destroy(platform_semaphore* semaphore) {
+    if (!semaphore || !semaphore->internal_data) {
+        return;
+    }
+
+    sem_destroy((sem_t*)semaphore->internal_data);
+    free(semaphore->internal_data);
+    semaphore->internal_data = 0;
+}
+
+void
+platform_semaphore_signal(platform_semaphore* semaphore) {
+    sem_post((sem_t*)semaphore->internal_data);
+}
+
+b8
+platform_semaphore_wait(platform_semaphore* semaphore, u64 timeout_ms) {
+    sem_t* handle = (sem_t*)semaphore->internal_data;
+
+    if (timeout_ms == PLATFORM_WAIT_INFINITE) {
+        // Retry if interrupted by a signal
+        while (sem_wait(handle) != 0) {
+            if (errno != EINTR) {
+                return FALSE;
+            }
+        }
+        return TRUE;
+    }
+
+    if (timeout_ms == 0) {
+        return sem_trywait(handle) == 0;
+    }
+
+    // sem_timedwait takes an absolute CLOCK_REALTIME deadline
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000 * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while (sem_timedwait(handle, &deadline) != 0) {
+        if (errno != EINTR) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+b8
+platform_condition_wait(platform_condition* condition, platform_mutex* mutex, u64 timeout_ms) {
+    pthread_cond_t* cond_handle = (pthread_cond_t*)condition->internal_data;
+    pthread_mutex_t* mutex_handle = (pthread_mutex_t*)mutex->internal_data;
+
+    if (timeout_ms == PLATFORM_WAIT_INFINITE) {
+        return pthread_cond_wait(cond_handle, mutex_handle) == 0;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000 * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    return pthread_cond_timedwait(cond_handle, mutex_handle, &deadline) == 0;
+}
+
+// FIBERS //
+
+typedef struct linux_fiber {
+    ucontext_t context;
+    // 0 for a thread's own context
+    void* stack;
+    u64 stack_size;
+    PFN_fiber_start start;
+    void* params;
+} linux_fiber;
+
+// makecontext only passes ints, so the fiber pointer arrives in two halves
+static void
+linux_fiber_trampoline(u32 high, u32 low) {
+    linux_fiber* fiber = (linux_fiber*)(((u64)high << 32) | (u64)low);
+    fiber->start(fiber->params);
+
+    // Returning would end the thread running the fiber
+    P_FATAL("A fiber's start function returned");
+    abort();
+}
+
+b8
+platform_fiber_from_thread(platform_fiber* out_fiber) {
+    linux_fiber* fiber = calloc(1, sizeof(linux_fiber));
+    out_fiber->internal_data = fiber;
+    return TRUE;
+}
+
+void
+platform_fiber_to_thread(platform_fiber* fiber) {
+    if (!fiber || !fiber->internal_data) {
+        return;
+    }
+
+    free(fiber->internal_data);
+    fiber->internal_data = 0;
+}
+
+b8
+platform_fiber_create(u64 stack_size, PFN_fiber_start start, void* params, platform_fiber* out_fiber) {
+    u64 page_size = (u64)sysconf(_SC_PAGESIZE);
+    stack_size = (stack_size + page_size - 1) & ~(page_size - 1);
+
+    // One extra page below the stack is left inaccessible, so an overflow faults instead of corrupting memory
+    u8* mapping = mmap(0, stack_size + page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (mapping == MAP_FAILED) {
+        P_ERROR("Unable to map a fiber stack: %s", strerror(errno));
+        return FALSE;
+    }
+    mprotect(mapping, page_size, PROT_NONE);
+
+    linux_fiber* fiber = calloc(1, sizeof(linux_fiber));
+    fiber->stack = mapping;
+    fiber->stack_size = stack_size + page_size;
+    fiber->start = start;
+    fiber->params = params;
+
+    getcontext(&fiber->context);
+    fiber->context.uc_stack.ss_sp = mapping + page_size;
+    fiber->context.uc_stack.ss_size = stack_size;
+    fiber->context.uc_link = 0;
+    u64 address = (u64)fiber;
+    makecontext(&fiber->context, (void (*)())linux_fiber_trampoline, 2, (u32)(address >> 32), (u32)address);
+
+    out_fiber->internal_data = fiber;
+    return TRUE;
+}
+
+void
+platform_fiber_destroy(platform_fiber* fiber) {
+    if (!fiber || !fiber->internal_data) {
+        return;
+    }
+
+    linux_fiber* handle = (linux_fiber*)fiber->internal_data;
+    if (handle->stack) {
+        munmap(handle->stack, handle->stack_size);
+    }
+    free(handle);
+    fiber->internal_data = 0;
+}
+
+void
+platform_fiber_switch(platform_fiber* from, platform_fiber* to) {
+    swapcontext(&((linux_fiber*)from->internal_data)->context, &((linux_fiber*)to->internal_data)->context);
+}
+
+// PERFORMANCE COUNTERS //
+
+typedef struct linux_perf_state {
+    // Every counter is in one group so they are scheduled, and read, together
+    i32 leader;
+    i32 fds[PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+    // Position of each counter in a group read. -1 if it could not be opened
+    i32 slots[PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+    u32 open_count;
+} linux_perf_state;
+
+static linux_perf_state perf_state;
+
+static const u64 perf_event_configs[PLATFORM_PERF_COUNTER_MAX_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static const char* perf_event_names[PLATFORM_PERF_COUNTER_MAX_COUNTERS] = {
+    "cycles",
+    "instructions",
+    "cache misses",
+    "branch misses"
+};
+
+b8
+platform_perf_counters_open() {
+    if (perf_state.open_count > 0) {
+        return TRUE;
+    }
+
+    perf_state.leader = -1;
+    for (u32 i = 0; i < PLATFORM_PERF_COUNTER_MAX_COUNTERS; ++i) {
+        perf_state.fds[i] = -1;
+        perf_state.slots[i] = -1;
+
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = perf_event_configs[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        // The group starts disabled and is enabled as a whole once complete
+        attr.disabled = perf_state.leader == -1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // This thread, any CPU
+        i32 fd = (i32)syscall(SYS_perf_event_open, &attr, 0, -1, perf_state.leader, 0);
+        if (fd < 0) {
+            P_WARN("Performance counter '%s' unavailable: %s", perf_event_names[i], strerror(errno));
+            continue;
+        }
+
+        if (perf_state.leader == -1) {
+            perf_state.leader = fd;
+        }
+        perf_state.fds[i] = fd;
+        perf_state.slots[i] = (i32)perf_state.open_count++;
+    }
+
+    if (perf_state.open_count == 0) {
+        P_WARN("No hardware performance counters could be opened. Check /proc/sys/kernel/perf_event_paranoid");
+        return FALSE;
+    }
+
+    ioctl(perf_state.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perf_state.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return TRUE;
+}
+
+void
+platform_perf_counters_close() {
+    if (perf_state.open_count == 0) {
+        return;
+    }
+
+    // Close the members before the leader
+    for (u32 i = 0; i < PLATFORM_PERF_COUNTER_MAX_COUNTERS; ++i) {
+        if (perf_state.fds[i] != -1 && perf_state.fds[i] != perf_state.leader) {
+            close(perf_state.fds[i]);
+        }
+    }
+    close(perf_state.leader);
+    memset(&perf_state, 0, sizeof(perf_state));
+}
+
+b8
+platform_perf_counter_available(platform_perf_counter counter) {
+    return perf_state.open_count > 0 && perf_state.slots[counter] != -1;
+}
+
+b8
+platform_perf_counters_read(platform_perf_counters* out_counters) {
+    memset(out_counters, 0, sizeof(platform_perf_counters));
+    if (perf_state.open_count == 0) {
+        return FALSE;
+    }
+
+    // Group layout: u64 count, then one u64 per counter in the order they were opened
+    u64 buffer[1 + PLATFORM_PERF_COUNTER_MAX_COUNTERS];
+    if (read(perf_state.leader, buffer, sizeof(buffer)) < (ssize_t)sizeof(u64)) {
+        return FALSE;
+    }
+
+    for (u32 i = 0; i < PLATFORM_PERF_COUNTER_MAX_COUNTERS; ++i) {
+        if (perf_state.slots[i] != -1 && (u64)perf_state.slots[i] < buffer[0]) {
+            out_counters->values[i] = buffer[1 + perf_state.slots[i]];
+        }
+    }
+    return TRUE;
+}
+
 // Get platform required extension names
 void
 platform_get_required_extension_names(const char*** ext_darray) {
@@ -369,6 +1746,11 @@ platform_get_required_extension_names(const char*** ext_darray) {
 
 b8
 platform_create_vulkan_surface(platform_state *pstate, vulkan_context *context) {
+    if (pstate->headless) {
+        P_ERROR("There is no window to create a Vulkan surface for when running headless");
+        return FALSE;
+    }
+
     // Cold cast state to the known type
     internal_state *state = (internal_state*)pstate->internal_state;
 
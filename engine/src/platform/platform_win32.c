@@ -1,4 +1,6 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_PLATFORM
 #include "platform.h"
+#include "platform_headless.h"
 
 
 // Windows platform layer
@@ -25,9 +27,8 @@ typedef struct internal_state {
   VkSurfaceKHR surface;
 } internal_state;
 
-// Clock
-static f64 clock_frequency;
-static LARGE_INTEGER start_time;
+// Clock. Ticks per second of the performance counter, read on first use
+static u64 tick_frequency;
 
 LRESULT CALLBACK win32_process_message(HWND hwnd, u32 msg, WPARAM w_param, LPARAM l_param);
 
@@ -38,8 +39,14 @@ b8 platform_startup(
   i32 x,
   i32 y,
   i32 width,
-  i32 height
+  i32 height,
+  b8 headless
 ) {
+  if (platform_headless_requested(headless)) {
+    return platform_headless_startup(pstate, width, height);
+  }
+  pstate->headless = FALSE;
+
   pstate->internal_state = malloc(sizeof(internal_state));
   internal_state *state = (internal_state*)pstate->internal_state;
 
@@ -116,18 +123,17 @@ b8 platform_startup(
   // If initially maximized, use SW_SHOWMAXIMIZED : SW_MAXIMIZE
   ShowWindow(state->hwnd, show_window_command_flags);
 
-  // Set the start time of application and setup the clock
-  LARGE_INTEGER frequency;
-  QueryPerformanceFrequency(&frequency);
-  clock_frequency = 1.0 / (f64)frequency.QuadPart;
-  QueryPerformanceCounter(&start_time);
-
   return TRUE;
 }
 
 // Shutdown behavior for the windows platform
 void
 platform_shutdown(platform_state *pstate) {
+  if (pstate->headless) {
+    platform_headless_shutdown(pstate);
+    return;
+  }
+
   // Simply cold-cast to the known type
   internal_state *state = (internal_state*)pstate->internal_state;
 
@@ -141,6 +147,10 @@ platform_shutdown(platform_state *pstate) {
 // Will be called once every game loop
 b8
 platform_pump_messages(platform_state *pstate) {
+  if (pstate->headless) {
+    return platform_headless_pump_messages(pstate);
+  }
+
   MSG message;
 
   // Takes messages from the queue and pump it to the application
@@ -152,6 +162,16 @@ platform_pump_messages(platform_state *pstate) {
   return TRUE;
 }
 
+b8
+platform_wait_messages(platform_state *pstate, u64 timeout_ms) {
+  if (pstate->headless) {
+    return platform_headless_wait_messages(pstate, timeout_ms);
+  }
+
+  DWORD timeout = timeout_ms == PLATFORM_WAIT_INFINITE ? INFINITE : timeout_ms >= INFINITE ? INFINITE - 1 : (DWORD)timeout_ms;
+  return MsgWaitForMultipleObjects(0, NULL, FALSE, timeout, QS_ALLINPUT) == WAIT_OBJECT_0;
+}
+
 // MEMORY FUNCTIONS //
 // TODO: change to custom allocator
 void*
@@ -204,12 +224,241 @@ platform_console_write_error(const char* message, u8 color) {
   WriteConsoleA(GetStdHandle(STD_ERROR_HANDLE), message, (DWORD)length, number_written, 0);
 }
 
+// FILES //
+
+b8
+platform_file_open(const char* path, b8 truncate, platform_file* out_file) {
+  HANDLE handle = CreateFileA(
+    path,
+    GENERIC_READ | GENERIC_WRITE,
+    FILE_SHARE_READ | FILE_SHARE_DELETE,
+    0,
+    truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+    FILE_ATTRIBUTE_NORMAL,
+    0);
+  if (handle == INVALID_HANDLE_VALUE) {
+    P_ERROR("Unable to open file '%s': %lu", path, GetLastError());
+    return FALSE;
+  }
+
+  out_file->internal_data = handle;
+  return TRUE;
+}
+
+void
+platform_file_close(platform_file* file) {
+  if (!file || !file->internal_data) {
+    return;
+  }
+
+  CloseHandle((HANDLE)file->internal_data);
+  file->internal_data = 0;
+}
+
+u64
+platform_file_size(platform_file* file) {
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx((HANDLE)file->internal_data, &size)) {
+    return 0;
+  }
+  return (u64)size.QuadPart;
+}
+
+b8
+platform_file_resize(platform_file* file, u64 size) {
+  LARGE_INTEGER position;
+  position.QuadPart = (LONGLONG)size;
+  if (!SetFilePointerEx((HANDLE)file->internal_data, position, 0, FILE_BEGIN)) {
+    return FALSE;
+  }
+  return SetEndOfFile((HANDLE)file->internal_data) != 0;
+}
+
+b8
+platform_file_append(platform_file* file, const void* data, u64 size) {
+  LARGE_INTEGER zero = {0};
+  if (!SetFilePointerEx((HANDLE)file->internal_data, zero, 0, FILE_END)) {
+    return FALSE;
+  }
+
+  const u8* bytes = (const u8*)data;
+  while (size > 0) {
+    DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+    DWORD written = 0;
+    if (!WriteFile((HANDLE)file->internal_data, bytes, chunk, &written, 0)) {
+      return FALSE;
+    }
+    bytes += written;
+    size -= written;
+  }
+  return TRUE;
+}
+
+void*
+platform_file_map(platform_file* file, u64 offset, u64 size) {
+  u64 mapping_size = offset + size;
+  HANDLE mapping = CreateFileMappingA(
+    (HANDLE)file->internal_data,
+    0,
+    PAGE_READWRITE,
+    (DWORD)(mapping_size >> 32),
+    (DWORD)(mapping_size & 0xFFFFFFFF),
+    0);
+  if (!mapping) {
+    return 0;
+  }
+
+  void* block = MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)(offset & 0xFFFFFFFF), size);
+
+  // The view keeps the mapping object alive until it is unmapped
+  CloseHandle(mapping);
+  return block;
+}
+
+void
+platform_file_unmap(void* block, u64 size) {
+  UnmapViewOfFile(block);
+}
+
+void
+platform_file_flush_mapped(void* block, u64 size) {
+  FlushViewOfFile(block, size);
+}
+
+u64
+platform_file_map_granularity() {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (u64)info.dwAllocationGranularity;
+}
+
+b8
+platform_file_rename(const char* from, const char* to) {
+  return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+b8
+platform_file_delete(const char* path) {
+  return DeleteFileA(path) != 0;
+}
+
+b8
+platform_file_copy(const char* from, const char* to) {
+  if (!CopyFileA(from, to, FALSE)) {
+    P_ERROR("Failed to copy '%s' to '%s'. Error %lu", from, to, GetLastError());
+    return FALSE;
+  }
+  return TRUE;
+}
+
+b8
+platform_file_write_time(const char* path, u64* out_time) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) {
+    return FALSE;
+  }
+  *out_time = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+  return TRUE;
+}
+
+// DYNAMIC LIBRARIES //
+
+b8
+platform_dynamic_library_load(const char* path, platform_dynamic_library* out_library) {
+  HMODULE module = LoadLibraryA(path);
+  if (!module) {
+    P_ERROR("Unable to load library '%s'. Error %lu", path, GetLastError());
+    return FALSE;
+  }
+
+  out_library->internal_data = module;
+  return TRUE;
+}
+
+void
+platform_dynamic_library_unload(platform_dynamic_library* library) {
+  if (!library || !library->internal_data) {
+    return;
+  }
+
+  FreeLibrary((HMODULE)library->internal_data);
+  library->internal_data = 0;
+}
+
+void*
+platform_dynamic_library_symbol(platform_dynamic_library* library, const char* name) {
+  return (void*)GetProcAddress((HMODULE)library->internal_data, name);
+}
+
 // TIME //
 f64
 platform_get_absolute_time() {
+  return (f64)platform_get_ticks() / (f64)platform_get_tick_frequency();
+}
+
+// TIMER //
+
+// The performance counter already reads the invariant TSC where Windows
+// trusts it, and falls back to another timer on its own where it does not
+u64
+platform_get_ticks() {
   LARGE_INTEGER now_time;
   QueryPerformanceCounter(&now_time);
-  return (f64)now_time.QuadPart * clock_frequency;
+  return (u64)now_time.QuadPart;
+}
+
+u64
+platform_get_tick_frequency() {
+  // Fixed at boot, so racing threads all store the same value
+  if (tick_frequency == 0) {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    tick_frequency = (u64)frequency.QuadPart;
+  }
+  return tick_frequency;
+}
+
+platform_timer_source
+platform_get_timer_source() {
+  return PLATFORM_TIMER_SOURCE_OS;
+}
+
+// Not in older SDK headers. Windows 10 1803 and later
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Each thread sleeps on its own timer
+static _Thread_local HANDLE sleep_timer;
+
+void
+platform_sleep_until(u64 deadline_ticks) {
+  u64 now_ticks = platform_get_ticks();
+  if (deadline_ticks <= now_ticks) {
+    return;
+  }
+
+  u64 frequency = platform_get_tick_frequency();
+  u64 remaining_ticks = deadline_ticks - now_ticks;
+  // Due times are in 100ns units
+  u64 remaining = (remaining_ticks / frequency) * 10000000ULL + (remaining_ticks % frequency) * 10000000ULL / frequency;
+
+  if (!sleep_timer) {
+    // The high resolution timer avoids the 1-15ms scheduler tick. Fall back to a normal one on older systems
+    sleep_timer = CreateWaitableTimerExW(0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!sleep_timer) {
+      sleep_timer = CreateWaitableTimerExW(0, 0, 0, TIMER_ALL_ACCESS);
+    }
+  }
+
+  LARGE_INTEGER due_time;
+  // Negative means relative to now
+  due_time.QuadPart = -(LONGLONG)remaining;
+  if (sleep_timer && SetWaitableTimer(sleep_timer, &due_time, 0, 0, 0, FALSE)) {
+    WaitForSingleObject(sleep_timer, INFINITE);
+  } else {
+    Sleep((DWORD)(remaining / 10000));
+  }
 }
 
 // Sleep
@@ -218,6 +467,397 @@ platform_sleep(u64 ms) {
   Sleep(ms);
 }
 
+// THREADING //
+
+typedef struct win32_thread_start {
+  PFN_thread_start start_function;
+  void* params;
+} win32_thread_start;
+
+// CreateThread expects DWORD WINAPI (*)(LPVOID), so hop through this to call the engine signature
+static DWORD WINAPI
+win32_thread_trampoline(LPVOID arg) {
+  win32_thread_start start = *(win32_thread_start*)arg;
+  free(arg);
+
+  return (DWORD)start.start_function(start.params);
+}
+
+b8
+platform_thread_create(PFN_thread_start start_function, void* params, platform_thread* out_thread) {
+  if (!start_function || !out_thread) {
+    return FALSE;
+  }
+
+  win32_thread_start* start = malloc(sizeof(win32_thread_start));
+  start->start_function = start_function;
+  start->params = params;
+
+  DWORD thread_id = 0;
+  HANDLE handle = CreateThread(0, 0, win32_thread_trampoline, start, 0, &thread_id);
+  if (!handle) {
+    P_ERROR("CreateThread failed: %lu", GetLastError());
+    free(start);
+    return FALSE;
+  }
+
+  out_thread->internal_data = handle;
+  out_thread->thread_id = thread_id;
+  return TRUE;
+}
+
+void
+platform_thread_join(platform_thread* thread) {
+  if (!thread || !thread->internal_data) {
+    return;
+  }
+
+  WaitForSingleObject((HANDLE)thread->internal_data, INFINITE);
+  CloseHandle((HANDLE)thread->internal_data);
+  thread->internal_data = 0;
+  thread->thread_id = 0;
+}
+
+u64
+platform_current_thread_id() {
+  return (u64)GetCurrentThreadId();
+}
+
+// SetThreadDescription only exists from Windows 10 1607, so look it up rather than link it
+typedef HRESULT (WINAPI *PFN_SetThreadDescription)(HANDLE thread, PCWSTR description);
+
+void
+platform_thread_set_name(const char* name) {
+  static PFN_SetThreadDescription set_thread_description = 0;
+  static b8 looked_up = FALSE;
+  if (!looked_up) {
+    HMODULE kernel32 = GetModuleHandleA("kernel32.dll");
+    set_thread_description = kernel32 ? (PFN_SetThreadDescription)GetProcAddress(kernel32, "SetThreadDescription") : 0;
+    looked_up = TRUE;
+  }
+
+  if (!set_thread_description) {
+    return;
+  }
+
+  WCHAR wide_name[64];
+  if (MultiByteToWideChar(CP_UTF8, 0, name, -1, wide_name, 64) == 0) {
+    return;
+  }
+  set_thread_description(GetCurrentThread(), wide_name);
+}
+
+b8
+platform_thread_set_affinity(u64 cpu_mask) {
+  if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)cpu_mask) == 0) {
+    P_WARN("SetThreadAffinityMask failed: %lu", GetLastError());
+    return FALSE;
+  }
+  return TRUE;
+}
+
+void
+platform_thread_yield() {
+  SwitchToThread();
+}
+
+u32
+platform_get_processor_count() {
+  DWORD count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+  if (count == 0) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = info.dwNumberOfProcessors;
+  }
+  return count ? (u32)count : 1;
+}
+
+b8
+platform_get_cpu_topology(platform_cpu_topology* out_topology) {
+  memset(out_topology, 0, sizeof(platform_cpu_topology));
+
+  DWORD length = 0;
+  GetLogicalProcessorInformation(0, &length);
+  if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+    return FALSE;
+  }
+
+  SYSTEM_LOGICAL_PROCESSOR_INFORMATION* entries = malloc(length);
+  if (!GetLogicalProcessorInformation(entries, &length)) {
+    P_WARN("GetLogicalProcessorInformation failed: %lu", GetLastError());
+    free(entries);
+    return FALSE;
+  }
+
+  // Only count processors the process may run on
+  DWORD_PTR process_mask = 0;
+  DWORD_PTR system_mask = 0;
+  GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask);
+  u64 allowed = (u64)process_mask;
+
+  u32 count = length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+  for (u32 i = 0; i < count; ++i) {
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION* entry = &entries[i];
+    u64 mask = (u64)entry->ProcessorMask & allowed;
+    switch (entry->Relationship) {
+      case RelationProcessorCore: {
+        if (mask && out_topology->physical_core_count < PLATFORM_MAX_LOGICAL_PROCESSORS) {
+          out_topology->core_masks[out_topology->physical_core_count++] = mask;
+          out_topology->logical_processor_count += (u32)__builtin_popcountll(mask);
+        }
+      } break;
+      case RelationNumaNode: {
+        if (mask && out_topology->numa_node_count < PLATFORM_MAX_NUMA_NODES) {
+          out_topology->numa_node_masks[out_topology->numa_node_count++] = mask;
+        }
+      } break;
+      case RelationCache: {
+        CACHE_DESCRIPTOR* cache = &entry->Cache;
+        if (cache->Level == 1 && cache->Type == CacheData) {
+          out_topology->l1_data_cache_size = cache->Size;
+          out_topology->cache_line_size = cache->LineSize;
+        } else if (cache->Level == 1 && cache->Type == CacheInstruction) {
+          out_topology->l1_instruction_cache_size = cache->Size;
+        } else if (cache->Level == 2) {
+          out_topology->l2_cache_size = cache->Size;
+        } else if (cache->Level == 3) {
+          out_topology->l3_cache_size = cache->Size;
+        }
+      } break;
+      default:
+        break;
+    }
+  }
+  free(entries);
+
+  if (out_topology->numa_node_count == 0) {
+    out_topology->numa_node_masks[0] = allowed;
+    out_topology->numa_node_count = 1;
+  }
+  if (out_topology->cache_line_size == 0) {
+    out_topology->cache_line_size = 64;
+  }
+  return out_topology->logical_processor_count > 0;
+}
+
+b8
+platform_mutex_create(platform_mutex* out_mutex) {
+  SRWLOCK* handle = malloc(sizeof(SRWLOCK));
+  InitializeSRWLock(handle);
+  out_mutex->internal_data = handle;
+  return TRUE;
+}
+
+void
+platform_mutex_destroy(platform_mutex* mutex) {
+  if (!mutex || !mutex->internal_data) {
+    return;
+  }
+
+  // SRW locks hold no kernel resources
+  free(mutex->internal_data);
+  mutex->internal_data = 0;
+}
+
+void
+platform_mutex_lock(platform_mutex* mutex) {
+  AcquireSRWLockExclusive((SRWLOCK*)mutex->internal_data);
+}
+
+b8
+platform_mutex_try_lock(platform_mutex* mutex) {
+  return TryAcquireSRWLockExclusive((SRWLOCK*)mutex->internal_data) != 0;
+}
+
+void
+platform_mutex_unlock(platform_mutex* mutex) {
+  ReleaseSRWLockExclusive((SRWLOCK*)mutex->internal_data);
+}
+
+b8
+platform_condition_create(platform_condition* out_condition) {
+  CONDITION_VARIABLE* handle = malloc(sizeof(CONDITION_VARIABLE));
+  InitializeConditionVariable(handle);
+  out_condition->internal_data = handle;
+  return TRUE;
+}
+
+void
+platform_condition_destroy(platform_condition* condition) {
+  if (!condition || !condition->internal_data) {
+    return;
+  }
+
+  free(condition->internal_data);
+  condition->internal_data = 0;
+}
+
+void
+platform_condition_signal(platform_condition* condition) {
+  WakeConditionVariable((CONDITION_VARIABLE*)condition->internal_data);
+}
+
+void
+platform_condition_broadcast(platform_condition* condition) {
+  WakeAllConditionVariable((CONDITION_VARIABLE*)condition->internal_data);
+}
+
+b8
+platform_semaphore_create(u32 initial_count, platform_semaphore* out_semaphore) {
+  HANDLE handle = CreateSemaphoreA(0, initial_count, 0x7FFFFFFF, 0);
+  if (!handle) {
+    P_ERROR("CreateSemaphore failed: %lu", GetLastError());
+    return FALSE;
+  }
+
+  out_semaphore->internal_data = handle;
+  return TRUE;
+}
+
+void
+platform_semaphore_destroy(platform_semaphore* semaphore) {
+  if (!semaphore || !semaphore->internal_data) {
+    return;
+  }
+
+  CloseHandle((HANDLE)semaphore->internal_data);
+  semaphore->internal_data = 0;
+}
+
+void
+platform_semaphore_signal(platform_semaphore* semaphore) {
+  ReleaseSemaphore((HANDLE)semaphore->internal_data, 1, 0);
+}
+
+b8
+platform_semaphore_wait(platform_semaphore* semaphore, u64 timeout_ms) {
+  DWORD wait_ms = timeout_ms == PLATFORM_WAIT_INFINITE ? INFINITE : (DWORD)timeout_ms;
+  return WaitForSingleObject((HANDLE)semaphore->internal_data, wait_ms) == WAIT_OBJECT_0;
+}
+
+b8
+platform_condition_wait(platform_condition* condition, platform_mutex* mutex, u64 timeout_ms) {
+  DWORD wait_ms = timeout_ms == PLATFORM_WAIT_INFINITE ? INFINITE : (DWORD)timeout_ms;
+  // Fails with ERROR_TIMEOUT when the time runs out. The lock is held again either way
+  return SleepConditionVariableSRW(
+    (CONDITION_VARIABLE*)condition->internal_data,
+    (SRWLOCK*)mutex->internal_data,
+    wait_ms,
+    0) != 0;
+}
+
+// FIBERS //
+
+typedef struct win32_fiber {
+  LPVOID handle;
+  // FALSE for a thread's own context, which is not deleted
+  b8 owned;
+  PFN_fiber_start start;
+  void* params;
+} win32_fiber;
+
+static VOID WINAPI
+win32_fiber_trampoline(LPVOID arg) {
+  win32_fiber* fiber = (win32_fiber*)arg;
+  fiber->start(fiber->params);
+
+  // Returning would end the thread running the fiber
+  P_FATAL("A fiber's start function returned");
+  ExitProcess(1);
+}
+
+b8
+platform_fiber_from_thread(platform_fiber* out_fiber) {
+  LPVOID handle = ConvertThreadToFiber(0);
+  if (!handle) {
+    if (GetLastError() != ERROR_ALREADY_FIBER) {
+      P_ERROR("ConvertThreadToFiber failed: %lu", GetLastError());
+      return FALSE;
+    }
+    handle = GetCurrentFiber();
+  }
+
+  win32_fiber* fiber = calloc(1, sizeof(win32_fiber));
+  fiber->handle = handle;
+  out_fiber->internal_data = fiber;
+  return TRUE;
+}
+
+void
+platform_fiber_to_thread(platform_fiber* fiber) {
+  if (!fiber || !fiber->internal_data) {
+    return;
+  }
+
+  ConvertFiberToThread();
+  free(fiber->internal_data);
+  fiber->internal_data = 0;
+}
+
+b8
+platform_fiber_create(u64 stack_size, PFN_fiber_start start, void* params, platform_fiber* out_fiber) {
+  win32_fiber* fiber = calloc(1, sizeof(win32_fiber));
+  fiber->owned = TRUE;
+  fiber->start = start;
+  fiber->params = params;
+
+  // Windows rounds the stack up to its allocation granularity and adds the guard page itself
+  fiber->handle = CreateFiber((SIZE_T)stack_size, win32_fiber_trampoline, fiber);
+  if (!fiber->handle) {
+    P_ERROR("CreateFiber failed: %lu", GetLastError());
+    free(fiber);
+    return FALSE;
+  }
+
+  out_fiber->internal_data = fiber;
+  return TRUE;
+}
+
+void
+platform_fiber_destroy(platform_fiber* fiber) {
+  if (!fiber || !fiber->internal_data) {
+    return;
+  }
+
+  win32_fiber* handle = (win32_fiber*)fiber->internal_data;
+  if (handle->owned) {
+    DeleteFiber(handle->handle);
+  }
+  free(handle);
+  fiber->internal_data = 0;
+}
+
+void
+platform_fiber_switch(platform_fiber* from, platform_fiber* to) {
+  // Windows saves the running fiber on its own
+  (void)from;
+  SwitchToFiber(((win32_fiber*)to->internal_data)->handle);
+}
+
+// PERFORMANCE COUNTERS //
+
+// Windows only exposes hardware counters to kernel drivers and ETW sessions
+b8
+platform_perf_counters_open() {
+  P_WARN("Hardware performance counters are not supported on Windows");
+  return FALSE;
+}
+
+void
+platform_perf_counters_close() {
+}
+
+b8
+platform_perf_counter_available(platform_perf_counter counter) {
+  return FALSE;
+}
+
+b8
+platform_perf_counters_read(platform_perf_counters* out_counters) {
+  ZeroMemory(out_counters, sizeof(platform_perf_counters));
+  return FALSE;
+}
+
 // Get the required vulkan extensions for windows
 void
 platform_get_required_extension_names(const char*** ext_darray) {
@@ -229,6 +869,11 @@ b8
 platform_create_vulkan_surface(
     platform_state* pstate,
     vulkan_context* context) {
+    if (pstate->headless) {
+        P_ERROR("There is no window to create a Vulkan surface for when running headless");
+        return FALSE;
+    }
+
     internal_state *state = (internal_state*)pstate->internal_state;
 
     VkWin32SurfaceCreateInfoKHR create_info = {VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR};
@@ -292,7 +937,7 @@ LRESULT CALLBACK win32_process_message(
 
       // Pass to the input subsystem for processing
       // P_INFO("GOT TO KEYDOWN/UP");
-      input_process_key(key, pressed);
+      input_process_key(key, pressed, GetMessageTime());
     } break;
     case WM_MOUSEMOVE: {
       // i32 x_position = GET_X_LPARAM(l_param);
@@ -300,14 +945,14 @@ LRESULT CALLBACK win32_process_message(
       i32 x_pos = GET_X_LPARAM(l_param);
       i32 y_pos = GET_Y_LPARAM(l_param);
 
-      input_process_mouse_move(x_pos, y_pos);
+      input_process_mouse_move(x_pos, y_pos, GetMessageTime());
     } break;
     case WM_MOUSEWHEEL: {
       i32 z_delta = GET_WHEEL_DELTA_WPARAM(w_param);
       if (z_delta != 0) {
         // flatten input to -1 or 1
         z_delta = (z_delta < 0) ? -1 : 1;
-        input_process_mouse_wheel(z_delta);
+        input_process_mouse_wheel(z_delta, GetMessageTime());
       }
     } break;
 
@@ -337,7 +982,7 @@ LRESULT CALLBACK win32_process_message(
 
       // Pass to the input subsystem
       if (mouse_button != BUTTON_MAX_BUTTONS) {
-        input_process_button(mouse_button, pressed);
+        input_process_button(mouse_button, pressed, GetMessageTime());
       }
     } break;
   }
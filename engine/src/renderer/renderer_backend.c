@@ -1,3 +1,4 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_RENDERER
 #include "renderer_backend.h"
 #include "vulkan/vulkan_backend.h"
 
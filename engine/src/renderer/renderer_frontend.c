@@ -1,14 +1,55 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_RENDERER
 #include "renderer_frontend.h"
 #include "renderer_backend.h"
 
 #include "core/logger.h"
 #include "core/pmemory.h"
+#include "core/profiler.h"
+#include "core/job_system.h"
+#include "platform/platform.h"
+
+// Packets queued when the config does not say. Double buffered
+#define RENDERER_DEFAULT_PACKET_COUNT 2
+
+/*
+  Ring of packets handed from the main thread to the render thread.
+  Everything in it is guarded by lock. A slot stays taken until its packet
+  has been drawn, so the main thread runs at most packet_count frames ahead
+*/
+typedef struct render_thread_state {
+  platform_thread thread;
+  platform_mutex lock;
+  // Signaled when a packet or a resize is queued, and when the thread should stop
+  platform_condition work;
+  // Signaled when the render thread finishes a packet
+  platform_condition done;
+
+  render_packet packets[RENDERER_MAX_QUEUED_PACKETS];
+  u32 packet_count;
+  // Packets queued and drawn since startup. queued - drawn are waiting or being drawn
+  u64 queued;
+  u64 drawn;
+
+  // Latest size the window was resized to, waiting to reach the backend
+  b8 resize_pending;
+  u16 width;
+  u16 height;
+
+  b8 stopping;
+  // Set when a frame fails to draw, and reported by the next renderer_draw_frame
+  b8 failed;
+} render_thread_state;
 
 // Backend render context
 static renderer_backend* backend = 0;
 
+static b8 threaded = FALSE;
+static render_thread_state render_thread;
+
+static u32 renderer_thread_main(void* params);
+
 b8
-renderer_initialize(const char* applicaation_name, struct platform_state* pstate) {
+renderer_initialize(const char* applicaation_name, struct platform_state* pstate, renderer_config* config) {
   backend = pallocate(sizeof(renderer_backend), MEMORY_TAG_RENDERER);
   // P_DEBUG("Backend address: %x size: %lu", backend, sizeof(renderer_backend));
 
@@ -22,30 +63,74 @@ renderer_initialize(const char* applicaation_name, struct platform_state* pstate
   }
   // P_DEBUG("PAST render_backend_create");
 
+  if (config && config->threaded) {
+    pzero_memory(&render_thread, sizeof(render_thread));
+    render_thread.packet_count = config->packet_count ? config->packet_count : RENDERER_DEFAULT_PACKET_COUNT;
+    if (render_thread.packet_count > RENDERER_MAX_QUEUED_PACKETS) {
+      render_thread.packet_count = RENDERER_MAX_QUEUED_PACKETS;
+    }
+
+    if (!platform_mutex_create(&render_thread.lock)) {
+      P_ERROR("Unable to create the render thread lock. Drawing on the main thread");
+      return TRUE;
+    }
+    if (!platform_condition_create(&render_thread.work) || !platform_condition_create(&render_thread.done)) {
+      P_ERROR("Unable to create the render thread conditions. Drawing on the main thread");
+      platform_condition_destroy(&render_thread.work);
+      platform_mutex_destroy(&render_thread.lock);
+      return TRUE;
+    }
+    if (!platform_thread_create(renderer_thread_main, 0, &render_thread.thread)) {
+      P_ERROR("Unable to start the render thread. Drawing on the main thread");
+      platform_condition_destroy(&render_thread.done);
+      platform_condition_destroy(&render_thread.work);
+      platform_mutex_destroy(&render_thread.lock);
+      return TRUE;
+    }
+
+    threaded = TRUE;
+    P_INFO("Render thread started with %u queued packets", render_thread.packet_count);
+  }
 
   return TRUE;
 }
 
 void
 renderer_shutdown() {
+  if (threaded) {
+    // The thread draws whatever is still queued before it exits
+    platform_mutex_lock(&render_thread.lock);
+    render_thread.stopping = TRUE;
+    platform_condition_signal(&render_thread.work);
+    platform_mutex_unlock(&render_thread.lock);
+    platform_thread_join(&render_thread.thread);
+
+    platform_condition_destroy(&render_thread.done);
+    platform_condition_destroy(&render_thread.work);
+    platform_mutex_destroy(&render_thread.lock);
+    threaded = FALSE;
+  }
+
   backend->shutdown(backend);
   pfree(backend, sizeof(renderer_backend), MEMORY_TAG_RENDERER);
 }
 
 b8
 renderer_begin_frame(f32 delta_time) {
+  P_PROFILE_SCOPE("renderer begin frame");
   return backend->begin_frame(backend, delta_time);
 }
 
 b8
 renderer_end_frame(f32 delta_time) {
+  P_PROFILE_SCOPE("renderer end frame");
   b8 result = backend->end_frame(backend, delta_time);
   backend->frame_number++;
   return result;
 }
 
-b8
-renderer_draw_frame(render_packet* packet) {
+static b8
+renderer_draw_packet(render_packet* packet) {
   // If the begin frame returned successfully, mid-frame operations may continue
   if (renderer_begin_frame(packet->delta_time)) {
     // End the frame. If this failed, it is likely unrecoverable
@@ -60,10 +145,90 @@ renderer_draw_frame(render_packet* packet) {
   return TRUE;
 }
 
+b8
+renderer_draw_frame(render_packet* packet) {
+  if (!threaded) {
+    return renderer_draw_packet(packet);
+  }
+
+  platform_mutex_lock(&render_thread.lock);
+  if (render_thread.queued - render_thread.drawn >= render_thread.packet_count) {
+    P_PROFILE_SCOPE("wait for render thread");
+    while (render_thread.queued - render_thread.drawn >= render_thread.packet_count) {
+      platform_condition_wait(&render_thread.done, &render_thread.lock, PLATFORM_WAIT_INFINITE);
+    }
+  }
+  render_thread.packets[render_thread.queued % render_thread.packet_count] = *packet;
+  render_thread.queued++;
+  b8 failed = render_thread.failed;
+  render_thread.failed = FALSE;
+  platform_condition_signal(&render_thread.work);
+  platform_mutex_unlock(&render_thread.lock);
+
+  return !failed;
+}
+
 void
 renderer_on_resized(u16 width, u16 height) {
-  if (backend) {
+  if (threaded) {
+    // The backend is only touched from the render thread
+    platform_mutex_lock(&render_thread.lock);
+    render_thread.resize_pending = TRUE;
+    render_thread.width = width;
+    render_thread.height = height;
+    platform_condition_signal(&render_thread.work);
+    platform_mutex_unlock(&render_thread.lock);
+  } else if (backend) {
     backend->resized(backend, width, height);
   } else
     P_WARN("renderer backend does not exist to accept this resize: %i, %i", width, height);
-}
\ No newline at end of file
+}
+
+// Draws queued packets in order, and passes resizes to the backend between them
+static u32
+renderer_thread_main(void* params) {
+  platform_thread_set_name("render");
+  profiler_name_thread("render");
+  // The job system holds a core back for this thread when it pins its own
+  u64 affinity = job_system_reserved_core_mask(0);
+  if (affinity && !platform_thread_set_affinity(affinity)) {
+    P_WARN("Unable to pin the render thread to its core");
+  }
+
+  platform_mutex_lock(&render_thread.lock);
+  for (;;) {
+    while (!render_thread.stopping && !render_thread.resize_pending && render_thread.drawn == render_thread.queued) {
+      platform_condition_wait(&render_thread.work, &render_thread.lock, PLATFORM_WAIT_INFINITE);
+    }
+
+    if (render_thread.resize_pending) {
+      u16 width = render_thread.width;
+      u16 height = render_thread.height;
+      render_thread.resize_pending = FALSE;
+      platform_mutex_unlock(&render_thread.lock);
+      backend->resized(backend, width, height);
+      platform_mutex_lock(&render_thread.lock);
+      continue;
+    }
+
+    if (render_thread.drawn == render_thread.queued) {
+      // Stopping, and nothing left to draw
+      break;
+    }
+
+    // The slot stays taken until drawn moves past it, so it is safe to read unlocked
+    render_packet* packet = &render_thread.packets[render_thread.drawn % render_thread.packet_count];
+    platform_mutex_unlock(&render_thread.lock);
+    b8 result = renderer_draw_packet(packet);
+    platform_mutex_lock(&render_thread.lock);
+
+    if (!result) {
+      render_thread.failed = TRUE;
+    }
+    render_thread.drawn++;
+    platform_condition_signal(&render_thread.done);
+  }
+  platform_mutex_unlock(&render_thread.lock);
+
+  return 0;
+}
@@ -4,9 +4,22 @@
 struct static_mesh_data;
 struct platform_state;
 
-b8 renderer_initialize(const char* application_name, struct platform_state* pstate);
+/*
+  Start the renderer
+  @param config - whether to draw on a render thread. 0 draws on the calling thread
+*/
+b8 renderer_initialize(const char* application_name, struct platform_state* pstate, renderer_config* config);
+
+// Finish every queued packet, stop the render thread, and release the backend
 void renderer_shutdown();
 
+// Applied by the render thread before the next packet it draws, when there is one
 void renderer_on_resized(u16 width, u16 height);
 
-b8 renderer_draw_frame(render_packet* packet);
\ No newline at end of file
+/*
+  Draw a frame. On a render thread the packet is copied into the queue and
+  this only blocks while the queue is full, so the caller can go on with the
+  next frame while this one is submitted
+  @returns FALSE if the frame could not be drawn or queued
+*/
+b8 renderer_draw_frame(render_packet* packet);
@@ -24,4 +24,15 @@ typedef struct renderer_backend {
 
 typedef struct render_packet {
   f32 delta_time;
-} render_packet;
\ No newline at end of file
+} render_packet;
+
+// Most packets that can wait between the main thread and the render thread
+#define RENDERER_MAX_QUEUED_PACKETS 3
+
+typedef struct renderer_config {
+  // Draw on a dedicated thread, so the main thread can simulate the next frame while this one is submitted
+  b8 threaded;
+  // Packets the main thread may queue ahead of the render thread: 2 double buffers, 3 triple buffers.
+  // More overlaps longer spikes, at a frame of latency each. 0 uses 2. Only used when threaded
+  u32 packet_count;
+} renderer_config;
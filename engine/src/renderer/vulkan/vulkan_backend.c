@@ -1,3 +1,4 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_RENDERER
 #include "vulkan_backend.h"
 #include "vulkan_device.h"
 #include "vulkan_swapchain.h"
@@ -44,6 +45,9 @@ vulkan_renderer_backend_initialize(renderer_backend* backend, const char* applic
     /// TODO: create custom allocator -- for now use default
     context.allocator = NULL;
 
+    // Without a window there is nothing to present to, so draw to images of our own
+    context.offscreen = pstate->headless;
+
     application_get_framebuffer_size(&cached_framebuffer_width, &cached_framebuffer_height);
     context.framebuffer_width = (cached_framebuffer_width != 0) ? cached_framebuffer_width : 800;
     context.framebuffer_height = (cached_framebuffer_height != 0) ? cached_framebuffer_height : 600;
@@ -66,8 +70,10 @@ vulkan_renderer_backend_initialize(renderer_backend* backend, const char* applic
 
     // Required Extensions
     const char** required_extensions = darray_create(const char*);
-    darray_push(required_extensions, &VK_KHR_SURFACE_EXTENSION_NAME); // generic surface extension
-    platform_get_required_extension_names(&required_extensions); // TODO: implement this function
+    if (!context.offscreen) {
+        darray_push(required_extensions, &VK_KHR_SURFACE_EXTENSION_NAME); // generic surface extension
+        platform_get_required_extension_names(&required_extensions); // TODO: implement this function
+    }
                                                                  
 #if defined(_DEBUG) 
     // if we are in DEBUG mode, load this extra extension
@@ -76,7 +82,7 @@ vulkan_renderer_backend_initialize(renderer_backend* backend, const char* applic
     P_DEBUG("Required Extensions:");
     u32 length = darray_length(required_extensions);
     for (u32 i = 0; i < length; i++) {
-        P_DEBUG(required_extensions[i]);
+        P_DEBUG("%s", required_extensions[i]);
     }
 #endif
 
@@ -154,12 +160,16 @@ vulkan_renderer_backend_initialize(renderer_backend* backend, const char* applic
   
     // Create surface
     // This is done by the surface, so that is why we use the platform to do this
-    P_DEBUG("Creating Vulkan surface...");
-    if (!platform_create_vulkan_surface(pstate, &context)) {
-        P_ERROR("Unable to create Vulkan surface");
-        return FALSE;
+    if (context.offscreen) {
+        P_INFO("No window to draw to. Rendering offscreen");
+    } else {
+        P_DEBUG("Creating Vulkan surface...");
+        if (!platform_create_vulkan_surface(pstate, &context)) {
+            P_ERROR("Unable to create Vulkan surface");
+            return FALSE;
+        }
+        P_DEBUG("Vulkan surface created.");
     }
-    P_DEBUG("Vulkan surface created.");
 
 
     // Create device
@@ -447,10 +457,12 @@ vulkan_renderer_backend_end_frame(renderer_backend* backend, f32 delta_time) {
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &command_buffer->handle;
 
-    submit_info.signalSemaphoreCount = 1;
+    // Offscreen images are ready as soon as their fence is, and nothing presents them,
+    // so there are no semaphores to wait on or signal
+    submit_info.signalSemaphoreCount = context.offscreen ? 0 : 1;
     submit_info.pSignalSemaphores = &context.queue_complete_semaphores[context.current_frame];
 
-    submit_info.waitSemaphoreCount = 1;
+    submit_info.waitSemaphoreCount = context.offscreen ? 0 : 1;
     submit_info.pWaitSemaphores = &context.image_availale_semaphores[context.current_frame];
 
     // Each semaphore waits on teh corresponding pipeline stage to complete
@@ -498,16 +510,16 @@ vk_debug_callback(
     switch (message_severity) {
         default:
         case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:
-            P_ERROR(callback_data->pMessage);
+            P_ERROR("%s", callback_data->pMessage);
             break;
         case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:
-            P_WARN(callback_data->pMessage);
+            P_WARN("%s", callback_data->pMessage);
             break;
         case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:
-            P_INFO(callback_data->pMessage);
+            P_INFO("%s", callback_data->pMessage);
             break;
         case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:
-            P_TRACE(callback_data->pMessage);
+            P_TRACE("%s", callback_data->pMessage);
             break;
     }
 
@@ -614,11 +626,13 @@ recreate_swapchain(renderer_backend* backend) {
     }
 
     // Requery support
-    vulkan_device_query_swapchain_support(
-        context.device.physical_device,
-        context.surface,
-        &context.device.swapchain_support
-    );
+    if (!context.offscreen) {
+        vulkan_device_query_swapchain_support(
+            context.device.physical_device,
+            context.surface,
+            &context.device.swapchain_support
+        );
+    }
     vulkan_device_detect_depth_format(&context.device);
 
     // recreate the swapchain
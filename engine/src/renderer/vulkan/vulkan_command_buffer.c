@@ -1,3 +1,4 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_RENDERER
 #include "vulkan_command_buffer.h"
 #include "core/pmemory.h"
 
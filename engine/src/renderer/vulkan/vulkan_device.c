@@ -1,3 +1,4 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_RENDERER
 #include "vulkan_device.h"
 #include "core/logger.h"
 #include "core/pstring.h"
@@ -82,7 +83,8 @@ b8 vulkan_device_create(vulkan_context* context) {
     device_create_info.queueCreateInfoCount = index_count;
     device_create_info.pQueueCreateInfos = queue_create_infos;
     device_create_info.pEnabledFeatures = &device_features;
-    device_create_info.enabledExtensionCount = 1;
+    // Offscreen there is nothing to present to, so no swapchain either
+    device_create_info.enabledExtensionCount = context->offscreen ? 0 : 1;
     const char* extension_names = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
     device_create_info.ppEnabledExtensionNames = &extension_names;
 
@@ -288,14 +290,17 @@ b8 select_physical_device(vulkan_context* context) {
         // configuration.
         vulkan_physical_device_requirements requirements = {};
         requirements.graphics = TRUE;
-        requirements.present = TRUE;
+        requirements.present = !context->offscreen;
         requirements.transfer = TRUE;
         // NOTE: Enable this if compute will be required.
         // requirements.compute = TRUE;
         requirements.sampler_anisotropy = TRUE;
-        requirements.discrete_gpu = TRUE;
-        requirements.device_extension_names = darray_create(const char*);
-        darray_push(requirements.device_extension_names, &VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        // Machines without a display often only have a software implementation
+        requirements.discrete_gpu = !context->offscreen;
+        if (!context->offscreen) {
+            requirements.device_extension_names = darray_create(const char*);
+            darray_push(requirements.device_extension_names, &VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
 
         vulkan_physical_device_queue_family_info queue_info = {};
         b8 result = physical_device_meets_requirements(
@@ -354,7 +359,8 @@ b8 select_physical_device(vulkan_context* context) {
 
             context->device.physical_device = physical_devices[i];
             context->device.graphics_queue_index = queue_info.graphics_family_index;
-            context->device.present_queue_index = queue_info.present_family_index;
+            // Offscreen nothing is presented. The graphics queue stands in for the present queue
+            context->device.present_queue_index = context->offscreen ? queue_info.graphics_family_index : queue_info.present_family_index;
             context->device.transfer_queue_index = queue_info.transfer_family_index;
             // NOTE: set compute index here if needed.
 
@@ -431,9 +437,11 @@ b8 physical_device_meets_requirements(
             }
         }
 
-        // Present queue?
+        // Present queue? Offscreen there is no surface to present to
         VkBool32 supports_present = VK_FALSE;
-        VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supports_present));
+        if (surface) {
+            VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supports_present));
+        }
         if (supports_present) {
             out_queue_info->present_family_index = i;
         }
@@ -459,12 +467,14 @@ b8 physical_device_meets_requirements(
         P_TRACE("Compute Family Index:  %i", out_queue_info->compute_family_index);
 
         // Query swapchain support.
-        vulkan_device_query_swapchain_support(
-            device,
-            surface,
-            out_swapchain_support);
+        if (surface) {
+            vulkan_device_query_swapchain_support(
+                device,
+                surface,
+                out_swapchain_support);
+        }
 
-        if (out_swapchain_support->format_count < 1 || out_swapchain_support->present_mode_count < 1) {
+        if (surface && (out_swapchain_support->format_count < 1 || out_swapchain_support->present_mode_count < 1)) {
             if (out_swapchain_support->formats) {
                 pfree(out_swapchain_support->formats, sizeof(VkSurfaceFormatKHR) * out_swapchain_support->format_count, MEMORY_TAG_RENDERER);
             }
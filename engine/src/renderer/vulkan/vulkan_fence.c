@@ -1,3 +1,4 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_RENDERER
 #include "vulkan_fence.h"
 
 #include "core/logger.h"
@@ -1,3 +1,4 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_RENDERER
 #include "vulkan_renderpass.h"
 
 #include "core/pmemory.h"
@@ -41,6 +42,10 @@ void vulkan_renderpass_create(
     color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;      // Do not expect any particular layout before render pass starts.
     color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;  // Transitioned to after the render pass
+    if (context->offscreen) {
+        // The present layout needs the swapchain extension. Keep the image ready to be read back
+        color_attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    }
     color_attachment.flags = 0;
 
     attachment_descriptions[0] = color_attachment;
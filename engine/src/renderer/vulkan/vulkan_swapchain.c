@@ -1,3 +1,4 @@
+#define P_LOG_CATEGORY LOG_CATEGORY_RENDERER
 #include "vulkan_swapchain.h"
 #include "core/logger.h"
 #include "core/pmemory.h"
@@ -6,6 +7,11 @@
 
 void create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain);
 void destroy(vulkan_context* context, vulkan_swapchain* swapchain);
+void create_offscreen(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain);
+void create_depth_attachment(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain);
+
+// Offscreen images to cycle through. One more than the frames in flight, like a swapchain would have
+#define VULKAN_OFFSCREEN_IMAGE_COUNT 3
 
 void
 vulkan_swapchain_create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* out_swapchain) {
@@ -33,6 +39,13 @@ vulkan_swapchain_acquire_next_image_index(
   VkFence fence,
   u32* out_image_index) {
 
+  if (context->offscreen) {
+    // Hand the images out in turn. The frame's fence already guarantees the GPU is done with it
+    *out_image_index = swapchain->next_image_index;
+    swapchain->next_image_index = (swapchain->next_image_index + 1) % swapchain->image_count;
+    return TRUE;
+  }
+
   // Get the index of the next image to be rendered
   VkResult result = vkAcquireNextImageKHR(
     context->device.logical_device,
@@ -62,6 +75,12 @@ void vulkan_swapchain_present(
   VkSemaphore render_complete_semaphore,
   u32 present_image_index) {
 
+  if (context->offscreen) {
+    // Nothing to show the image on. Move on to the next frame
+    context->current_frame = (context->current_frame + 1) % swapchain->max_frames_in_flight;
+    return;
+  }
+
   VkPresentInfoKHR present_info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
   present_info.waitSemaphoreCount = 1;
   present_info.pWaitSemaphores = &render_complete_semaphore;
@@ -88,6 +107,11 @@ create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapcha
   VkExtent2D swapchain_extent = {width, height};
   swapchain->max_frames_in_flight = 2; // triple buffering if possible | 2 frames being rendered to as we draw and present a third
 
+  if (context->offscreen) {
+    create_offscreen(context, width, height, swapchain);
+    return;
+  }
+
   b8 found = FALSE;
   for (u32 i = 0; i < context->device.swapchain_support.format_count; i++) {
     VkSurfaceFormatKHR format = context->device.swapchain_support.formats[i];
@@ -222,6 +246,57 @@ create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapcha
     ));
   }
 
+  create_depth_attachment(context, swapchain_extent.width, swapchain_extent.height, swapchain);
+
+  P_INFO("Swapchain created successfully.");
+}
+
+// Stand in for a swapchain with images of our own, for rendering without a window
+void
+create_offscreen(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain) {
+  swapchain->image_format.format = VK_FORMAT_B8G8R8A8_UNORM;
+  swapchain->image_format.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+  swapchain->handle = 0;
+  swapchain->image_count = VULKAN_OFFSCREEN_IMAGE_COUNT;
+  swapchain->next_image_index = 0;
+  context->current_frame = 0;
+
+  if (!swapchain->color_attachments) {
+    swapchain->color_attachments = (vulkan_image*)pallocate(sizeof(vulkan_image) * swapchain->image_count, MEMORY_TAG_RENDERER);
+  }
+  if (!swapchain->images) {
+    swapchain->images = (VkImage*)pallocate(sizeof(VkImage) * swapchain->image_count, MEMORY_TAG_RENDERER);
+  }
+  if (!swapchain->views) {
+    swapchain->views = (VkImageView*)pallocate(sizeof(VkImageView) * swapchain->image_count, MEMORY_TAG_RENDERER);
+  }
+
+  for (u32 i = 0; i < swapchain->image_count; i++) {
+    // Transfer source so frames can be read back or compared
+    vulkan_image_create(
+      context,
+      VK_IMAGE_TYPE_2D,
+      width,
+      height,
+      swapchain->image_format.format,
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      TRUE,
+      VK_IMAGE_ASPECT_COLOR_BIT,
+      &swapchain->color_attachments[i]
+    );
+    swapchain->images[i] = swapchain->color_attachments[i].handle;
+    swapchain->views[i] = swapchain->color_attachments[i].view;
+  }
+
+  create_depth_attachment(context, width, height, swapchain);
+
+  P_INFO("Offscreen render target created: %ux%u, %u images.", width, height, swapchain->image_count);
+}
+
+void
+create_depth_attachment(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain) {
   // Create resource for the depth buffer
   if (!vulkan_device_detect_depth_format(&context->device)) {
     context->device.depth_format = VK_FORMAT_UNDEFINED;
@@ -232,8 +307,8 @@ create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapcha
   vulkan_image_create(
     context,
     VK_IMAGE_TYPE_2D,
-    swapchain_extent.width,
-    swapchain_extent.height,
+    width,
+    height,
     context->device.depth_format,
     VK_IMAGE_TILING_OPTIMAL,
     VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
@@ -242,8 +317,6 @@ create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapcha
     VK_IMAGE_ASPECT_DEPTH_BIT,
     &swapchain->depth_attachment
   );
-
-  P_INFO("Swapchain created successfully.");
 }
 
 void 
@@ -251,6 +324,14 @@ destroy(vulkan_context* context, vulkan_swapchain* swapchain) {
   vkDeviceWaitIdle(context->device.logical_device);
   vulkan_image_destroy(context, &swapchain->depth_attachment);
 
+  if (context->offscreen) {
+    // These images are ours, views included
+    for (u32 i = 0; i < swapchain->image_count; i++) {
+      vulkan_image_destroy(context, &swapchain->color_attachments[i]);
+    }
+    return;
+  }
+
   // Only destroy the views not images since those are owned by the swapchain
   // and are destroyed when it is
   for (u32 i = 0; i < swapchain->image_count; i++) {
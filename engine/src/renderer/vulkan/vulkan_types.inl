@@ -88,6 +88,11 @@ typedef struct vulkan_swapchain {
 
     vulkan_image depth_attachment;
     vulkan_framebuffer* framebuffers;
+
+    // Offscreen only: images created in place of the ones a swapchain would own,
+    // handed out in turn. images and views point into these
+    vulkan_image* color_attachments;
+    u32 next_image_index;
 } vulkan_swapchain;
 
 // COMMAND BUFFERS
@@ -127,6 +132,8 @@ typedef struct vulkan_context {
                                     // this will be NULL for now to 
                                     // use the deiver's default allocator
   VkSurfaceKHR surface;
+  // Drawing to images of our own, with no surface or presentation. Set when the platform runs headless
+  b8 offscreen;
 #if defined(_DEBUG)
   VkDebugUtilsMessengerEXT debug_messenger;
 #endif /* _DEBUG */
@@ -5,9 +5,12 @@ SetLocal EnableDelayedExpansion
 REM Get a list of all the .c files.
 SET cFilenames=
 FOR /R %%f in (*.c) do (
-    SET cFilenames=!cFilenames! %%f
+    IF /I NOT "%%~nxf"=="game.c" SET cFilenames=!cFilenames! %%f
 )
 
+REM Game code goes in its own library, which the engine reloads when it changes
+SET gameFilenames=src/game.c
+
 REM echo "Files:" %cFilenames%
 
 SET assembly=testbed
@@ -17,5 +20,8 @@ SET includeFlags=-Isrc -I../engine/src/
 SET linkerFlags=-L../bin/ -lengine.lib
 SET defines=-D_DEBUG -DKIMPORT
 
+ECHO "Building %assembly%_game..."
+clang %gameFilenames% %compilerFlags% -shared -o ../bin/%assembly%_game.dll %defines% %includeFlags% %linkerFlags%
+
 ECHO "Building %assembly%%..."
 clang %cFilenames% %compilerFlags% -o ../bin/%assembly%.exe %defines% %includeFlags% %linkerFlags%
\ No newline at end of file
@@ -5,8 +5,12 @@ set echo on
 
 mkdir -p ../bin
 
-# Get list of all .c files
-cFilenames=$(find . -type f -name "*.c")
+# Game code goes in its own library, which the engine reloads when it changes.
+# Rerun this script while the testbed is running to swap in the changes
+gameFilenames="./src/game.c"
+
+# Get list of all other .c files
+cFilenames=$(find . -type f -name "*.c" ! -path "$gameFilenames")
 
 assembly="testbed"
 cflags="-g -fdeclspec -fPIC"
@@ -15,6 +19,9 @@ includes="-Isrc -I../engine/src"
 ldflags="-L../bin/ -lengine -Wl,-rpath,./bin/" # allows us to load at runtime
 defines="-D_DEBUG -DPIMPORT"
 
+echo "Building ${assembly}_game..."
+clang $gameFilenames $cflags -shared -o ../bin/lib${assembly}_game.so $defines $includes $ldflags
+
 echo "Building $assembly..."
 echo clang $cFilenames $cflags -o ../bin/$assembly $defines $includes $ldflags
 clang $cFilenames $cflags -o ../bin/$assembly $defines $includes $ldflags
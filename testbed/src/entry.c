@@ -12,11 +12,20 @@ create_game(game* out_game) {
     out_game->app_config.start_width = 1280;
     out_game->app_config.start_height = 720;
     out_game->app_config.name = "Pegasus Engine Testbed";
+    out_game->app_config.logging.log_file_path = "console.log";
+    out_game->app_config.logging.max_file_count = 3;
+    out_game->app_config.pacing.target_fps = 60;
+    out_game->app_config.fixed_timestep = 1.0 / 60.0;
+    out_game->app_config.renderer.threaded = TRUE;
+    out_game->app_config.profile_capture_key = KEY_F9;
+    out_game->app_config.frame_stats_key = KEY_F10;
 
-    out_game->initialize = game_initialize;
-    out_game->update = game_update;
-    out_game->render = game_render;
-    out_game->on_resize = game_on_resize;
+    // Game code is built into its own library and reloaded whenever it is rebuilt
+#if P_PLATFORM_WINDOWS
+    out_game->app_config.game_module_path = "./bin/testbed_game.dll";
+#else
+    out_game->app_config.game_module_path = "./bin/libtestbed_game.so";
+#endif
 
     out_game->state = pallocate(sizeof(game_state), MEMORY_TAG_GAME); 
 
@@ -1,5 +1,15 @@
 #include "game.h"
 #include <core/logger.h>
+#include <core/game_module.h>
+
+// Called by the engine each time this module is loaded, including after a rebuild
+GAME_MODULE_EXPORT b8 game_module_bind(game* game_inst, b8 reloaded) {
+    game_inst->initialize = game_initialize;
+    game_inst->update = game_update;
+    game_inst->render = game_render;
+    game_inst->on_resize = game_on_resize;
+    return TRUE;
+}
 
 b8 game_initialize(game *game_inst) {
     P_DEBUG("game init");
@@ -8,7 +18,7 @@ b8 game_initialize(game *game_inst) {
 b8 game_update(game* game_inst, f32 delta_time) {
     return TRUE;
 }
-b8 game_render(game* game_inst, f32 delta_time) {
+b8 game_render(game* game_inst, f32 delta_time, f32 alpha) {
     return TRUE;
 }
 void game_on_resize(game* game_inst, u32 width, u32 height) {
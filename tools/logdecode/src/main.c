@@ -0,0 +1,25 @@
+#include <defines.h>
+#include <core/pmemory.h>
+#include <core/log_deferred.h>
+
+#include <stdio.h>
+
+/*
+ * Converts a binary log written by the engine into text
+ * usage: logdecode <input.plog> [output.txt]
+ */
+int
+main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s <input.plog> [output.txt]\n", argv[0]);
+        return 1;
+    }
+
+    initialize_memory();
+
+    const char* output_path = argc == 3 ? argv[2] : 0;
+    b8 result = log_binary_decode_file(argv[1], output_path);
+
+    shutdown_memory();
+    return result ? 0 : 2;
+}